@@ -212,19 +212,19 @@ static void cpu_exec_nocache(CPUState *cpu, int max_cycles,
        We only end up here when an existing TB is too long.  */
     cflags |= MIN(max_cycles, CF_COUNT_MASK);
 
-    mmap_lock();
+    mmap_read_lock();
     tb = tb_gen_code(cpu, orig_tb->pc, orig_tb->cs_base,
                      orig_tb->flags, cflags);
     tb->orig_tb = orig_tb;
-    mmap_unlock();
+    mmap_read_unlock();
 
     /* execute the generated code */
     trace_exec_tb_nocache(tb, tb->pc);
     cpu_tb_exec(cpu, tb);
 
-    mmap_lock();
+    mmap_read_lock();
     tb_phys_invalidate(tb, -1);
-    mmap_unlock();
+    mmap_read_unlock();
     tcg_tb_remove(tb);
 }
 #endif
@@ -243,9 +243,9 @@ void cpu_exec_step_atomic(CPUState *cpu)
     if (sigsetjmp(cpu->jmp_env, 0) == 0) {
         tb = tb_lookup__cpu_state(cpu, &pc, &cs_base, &flags, cf_mask);
         if (tb == NULL) {
-            mmap_lock();
+            mmap_read_lock();
             tb = tb_gen_code(cpu, pc, cs_base, flags, cflags);
-            mmap_unlock();
+            mmap_read_unlock();
         }
 
         start_exclusive();
@@ -261,10 +261,11 @@ void cpu_exec_step_atomic(CPUState *cpu)
     } else {
         /*
          * The mmap_lock is dropped by tb_gen_code if it runs out of
-         * memory.
+         * memory, and by tb_gen_code_cleanup on a guest fault.
          */
+        tb_gen_code_cleanup();
 #ifndef CONFIG_SOFTMMU
-        tcg_debug_assert(!have_mmap_lock());
+        tcg_debug_assert(!have_mmap_read_lock());
 #endif
         assert_no_pages_locked();
     }
@@ -400,11 +401,11 @@ static inline TranslationBlock *tb_find(CPUState *cpu,
 
     tb = tb_lookup__cpu_state(cpu, &pc, &cs_base, &flags, cf_mask);
     if (tb == NULL) {
-        mmap_lock();
+        mmap_read_lock();
         tb = tb_gen_code(cpu, pc, cs_base, flags, cf_mask);
-        mmap_unlock();
+        mmap_read_unlock();
         /* We add the TB in the virtual pc hash table for the fast lookup */
-        atomic_set(&cpu->tb_jmp_cache[tb_jmp_cache_hash_func(pc)], tb);
+        tb_jmp_cache_insert(cpu, tb_jmp_cache_set(cpu, pc), tb);
     }
 #ifndef CONFIG_USER_ONLY
     /* We don't take care of direct jumps when address mapping changes in
@@ -693,8 +694,9 @@ int cpu_exec(CPUState *cpu)
         g_assert(cpu == current_cpu);
         g_assert(cc == CPU_GET_CLASS(cpu));
 #endif /* buggy compiler */
+        tb_gen_code_cleanup();
 #ifndef CONFIG_SOFTMMU
-        tcg_debug_assert(!have_mmap_lock());
+        tcg_debug_assert(!have_mmap_read_lock());
 #endif
         if (qemu_mutex_iothread_locked()) {
             qemu_mutex_unlock_iothread();
@@ -0,0 +1,354 @@
+/*
+ * Linux perf perf-<pid>.map and jit-<pid>.dump integration.
+ *
+ * The perf map assigns a name to every translated block so that
+ * "perf report" attributes host samples to guest functions.  The jitdump
+ * file additionally carries the generated code and a debug-info record
+ * mapping each guest instruction (packet, on Hexagon) to its host range;
+ * inject it with "perf inject -j" to get per-instruction attribution.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/error-report.h"
+#include "qemu/thread.h"
+#include "elf.h"
+#include "disas/disas.h"
+#include "exec/exec-all.h"
+#include "tcg.h"
+#include "perf.h"
+
+#define PERF_SYMBOL_LEN 256
+
+/* Taken by the writers, which run in every translating thread, and by
+   perf_exit(), so that a file is not closed under a writer */
+static QemuMutex perf_lock;
+static FILE *perfmap;
+static FILE *jitdump;
+static void *jitdump_marker;
+static size_t jitdump_marker_size;
+static uint64_t jitdump_code_index;
+
+static uint64_t perf_timestamp(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static FILE *perf_open(const char *fmt, const char *what)
+{
+    char name[64];
+    FILE *f;
+
+    snprintf(name, sizeof(name), fmt, (int)getpid());
+    f = fopen(name, "w+b");
+    if (f == NULL) {
+        warn_report("Could not open %s: %s, proceeding without %s",
+                    name, strerror(errno), what);
+    }
+    return f;
+}
+
+static void perf_atexit(void)
+{
+    perf_exit();
+}
+
+static void perf_init(void)
+{
+    static bool initialized;
+
+    if (!initialized) {
+        qemu_mutex_init(&perf_lock);
+        atexit(perf_atexit);
+        initialized = true;
+    }
+}
+
+void perf_enable_perfmap(void)
+{
+    perfmap = perf_open("/tmp/perf-%d.map", "perfmap");
+    if (perfmap != NULL) {
+        perf_init();
+    }
+}
+
+/* Layout of the jitdump file, see tools/perf/util/jitdump.h in Linux. */
+#define JITHEADER_MAGIC   0x4A695444
+#define JITHEADER_VERSION 1
+
+struct jitheader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t total_size;
+    uint32_t elf_mach;
+    uint32_t pad1;
+    uint32_t pid;
+    uint64_t timestamp;
+    uint64_t flags;
+};
+
+enum jit_record_type {
+    JIT_CODE_LOAD = 0,
+    JIT_CODE_DEBUG_INFO = 2,
+};
+
+struct jr_prefix {
+    uint32_t id;
+    uint32_t total_size;
+    uint64_t timestamp;
+};
+
+struct jr_code_load {
+    struct jr_prefix p;
+    uint32_t pid;
+    uint32_t tid;
+    uint64_t vma;
+    uint64_t code_addr;
+    uint64_t code_size;
+    uint64_t code_index;
+};
+
+struct debug_entry {
+    uint64_t addr;
+    int32_t lineno;
+    int32_t discrim;
+    /* Followed by a NUL-terminated file name */
+};
+
+struct jr_code_debug_info {
+    struct jr_prefix p;
+    uint64_t code_addr;
+    uint64_t nr_entry;
+    /* Followed by nr_entry struct debug_entry */
+};
+
+static uint32_t perf_host_elf_machine(void)
+{
+    Elf64_Ehdr ehdr;
+    uint32_t mach = EM_NONE;
+    int fd;
+
+    fd = open("/proc/self/exe", O_RDONLY);
+    if (fd < 0) {
+        return mach;
+    }
+    /* e_machine is at the same offset in Elf32_Ehdr and Elf64_Ehdr */
+    if (read(fd, &ehdr, sizeof(ehdr)) == sizeof(ehdr)) {
+        mach = ehdr.e_machine;
+    }
+    close(fd);
+    return mach;
+}
+
+void perf_enable_jitdump(void)
+{
+    struct jitheader header;
+
+    jitdump = perf_open("/tmp/jit-%d.dump", "jitdump");
+    if (jitdump == NULL) {
+        return;
+    }
+
+    /*
+     * "perf record" only notices the dump if the file is mapped
+     * executable; perf inject looks for that mapping afterwards.
+     */
+    jitdump_marker_size = qemu_real_host_page_size;
+    jitdump_marker = mmap(NULL, jitdump_marker_size, PROT_READ | PROT_EXEC,
+                          MAP_PRIVATE, fileno(jitdump), 0);
+    if (jitdump_marker == MAP_FAILED) {
+        warn_report("Could not map the jitdump file: %s, "
+                    "proceeding without jitdump", strerror(errno));
+        fclose(jitdump);
+        jitdump = NULL;
+        return;
+    }
+
+    memset(&header, 0, sizeof(header));
+    header.magic = JITHEADER_MAGIC;
+    header.version = JITHEADER_VERSION;
+    header.total_size = sizeof(header);
+    header.elf_mach = perf_host_elf_machine();
+    header.pid = getpid();
+    header.timestamp = perf_timestamp();
+    fwrite(&header, sizeof(header), 1, jitdump);
+    perf_init();
+}
+
+/*
+ * Name the TB after the guest function containing it.  The lookup walks
+ * the symbol tables, so it is done once per TB, at translation time, and
+ * the result shared by every record describing that TB.
+ */
+static void perf_tb_symbol(TranslationBlock *tb, char *buf, size_t len)
+{
+    const char *symbol = lookup_symbol(tb->pc);
+
+    if (symbol[0] != '\0') {
+        snprintf(buf, len, "%s", symbol);
+    } else {
+        snprintf(buf, len, "guest-0x" TARGET_FMT_lx, tb->pc);
+    }
+}
+
+/*
+ * The qemu_ld/st slow paths of a TB may be emitted out of line, see
+ * tcg_out_ldst_finalize; they are reported as a second symbol, with a
+ * ".cold" suffix.
+ */
+#define PERF_COLD_SUFFIX ".cold"
+
+/* Called with perf_lock held */
+static void perf_write_perfmap(TranslationBlock *tb, const char *symbol)
+{
+    fprintf(perfmap, "%" PRIxPTR " %zx %s [0x" TARGET_FMT_lx "-0x"
+            TARGET_FMT_lx ")\n", (uintptr_t)tb->tc.ptr, tb->tc.size,
+            symbol, tb->pc, tb->pc + tb->size);
+    if (tcg_ctx->tb_cold_size) {
+        fprintf(perfmap, "%" PRIxPTR " %zx %s" PERF_COLD_SUFFIX " [0x"
+                TARGET_FMT_lx "-0x" TARGET_FMT_lx ")\n",
+                (uintptr_t)tcg_ctx->tb_cold_ptr, tcg_ctx->tb_cold_size,
+                symbol, tb->pc, tb->pc + tb->size);
+    }
+}
+
+/*
+ * perf stores line numbers as int32_t.  A guest pc from 2^31 up is given
+ * as its offset from 2^31, in a file named after the symbol with a "+2G"
+ * suffix, so that it neither wraps to a negative line nor gets truncated.
+ */
+#define PERF_HIGH_SUFFIX "+2G"
+
+static bool perf_pc_is_high(target_ulong pc)
+{
+    return pc > INT32_MAX;
+}
+
+static int32_t perf_pc_lineno(target_ulong pc)
+{
+    if (perf_pc_is_high(pc)) {
+        pc -= (target_ulong)INT32_MAX + 1;
+        /* Beyond 4GB, only the lowest 31 bits are kept */
+        pc &= INT32_MAX;
+    }
+    return pc;
+}
+
+/* Called with perf_lock held */
+static void perf_write_jitdump_load(const void *code, size_t size,
+                                    const char *symbol, const char *suffix,
+                                    uint64_t timestamp)
+{
+    struct jr_code_load load;
+    size_t symbol_size = strlen(symbol);
+    size_t suffix_size = strlen(suffix) + 1;
+
+    load.p.id = JIT_CODE_LOAD;
+    load.p.total_size = sizeof(load) + symbol_size + suffix_size + size;
+    load.p.timestamp = timestamp;
+    load.pid = getpid();
+    load.tid = qemu_get_thread_id();
+    load.vma = (uintptr_t)code;
+    load.code_addr = (uintptr_t)code;
+    load.code_size = size;
+    load.code_index = jitdump_code_index++;
+    fwrite(&load, sizeof(load), 1, jitdump);
+    fwrite(symbol, symbol_size, 1, jitdump);
+    fwrite(suffix, suffix_size, 1, jitdump);
+    fwrite(code, size, 1, jitdump);
+}
+
+/* Called with perf_lock held */
+static void perf_write_jitdump(TranslationBlock *tb, const char *symbol)
+{
+    struct jr_code_debug_info debug;
+    size_t symbol_size = strlen(symbol) + 1;
+    size_t suffix_size = strlen(PERF_HIGH_SUFFIX);
+    uint64_t timestamp = perf_timestamp();
+    unsigned i;
+
+    /* Each guest instruction becomes a "line" of the translated block */
+    debug.p.id = JIT_CODE_DEBUG_INFO;
+    debug.p.total_size = sizeof(debug) +
+                         tb->icount * (sizeof(struct debug_entry) +
+                                       symbol_size);
+    for (i = 0; i < tb->icount; i++) {
+        if (perf_pc_is_high(tcg_ctx->gen_insn_data[i][0])) {
+            debug.p.total_size += suffix_size;
+        }
+    }
+    debug.p.timestamp = timestamp;
+    debug.code_addr = (uintptr_t)tb->tc.ptr;
+    debug.nr_entry = tb->icount;
+
+    fwrite(&debug, sizeof(debug), 1, jitdump);
+    for (i = 0; i < tb->icount; i++) {
+        struct debug_entry entry;
+        uint16_t start = i == 0 ? 0 : tcg_ctx->gen_insn_end_off[i - 1];
+        target_ulong pc = tcg_ctx->gen_insn_data[i][0];
+
+        entry.addr = (uintptr_t)tb->tc.ptr + start;
+        entry.lineno = perf_pc_lineno(pc);
+        entry.discrim = 0;
+        fwrite(&entry, sizeof(entry), 1, jitdump);
+        if (perf_pc_is_high(pc)) {
+            fwrite(symbol, symbol_size - 1, 1, jitdump);
+            fwrite(PERF_HIGH_SUFFIX, suffix_size + 1, 1, jitdump);
+        } else {
+            fwrite(symbol, symbol_size, 1, jitdump);
+        }
+    }
+    perf_write_jitdump_load(tb->tc.ptr, tb->tc.size, symbol, "", timestamp);
+    if (tcg_ctx->tb_cold_size) {
+        perf_write_jitdump_load(tcg_ctx->tb_cold_ptr, tcg_ctx->tb_cold_size,
+                                symbol, PERF_COLD_SUFFIX, timestamp);
+    }
+}
+
+void perf_report_code(TranslationBlock *tb)
+{
+    char symbol[PERF_SYMBOL_LEN];
+
+    if (atomic_read(&perfmap) == NULL && atomic_read(&jitdump) == NULL) {
+        return;
+    }
+    /* The code of these is freed as soon as it has run once */
+    if (tb_cflags(tb) & CF_NOCACHE) {
+        return;
+    }
+
+    perf_tb_symbol(tb, symbol, sizeof(symbol));
+    qemu_mutex_lock(&perf_lock);
+    if (perfmap != NULL) {
+        perf_write_perfmap(tb, symbol);
+    }
+    if (jitdump != NULL) {
+        perf_write_jitdump(tb, symbol);
+    }
+    qemu_mutex_unlock(&perf_lock);
+}
+
+void perf_exit(void)
+{
+    if (perfmap == NULL && jitdump == NULL) {
+        return;
+    }
+
+    qemu_mutex_lock(&perf_lock);
+    if (perfmap != NULL) {
+        fclose(perfmap);
+        atomic_set(&perfmap, NULL);
+    }
+
+    if (jitdump != NULL) {
+        munmap(jitdump_marker, jitdump_marker_size);
+        fclose(jitdump);
+        atomic_set(&jitdump, NULL);
+    }
+    qemu_mutex_unlock(&perf_lock);
+}
@@ -58,6 +58,7 @@
 #include "qemu/main-loop.h"
 #include "exec/log.h"
 #include "sysemu/cpus.h"
+#include "perf.h"
 
 /* #define DEBUG_TB_INVALIDATE */
 /* #define DEBUG_TB_FLUSH */
@@ -89,14 +90,16 @@
 
 /* Access to the various translations structures need to be serialised via locks
  * for consistency.
- * In user-mode emulation access to the memory related structures are protected
- * with mmap_lock.
- * In !user-mode we use per-page locks.
+ * We use per-page locks.  In user-mode emulation the memory layout must also
+ * stay put, so at least the read side of mmap_lock is held; holding mmap_lock
+ * itself excludes all the translations, and thus stands for the page locks.
  */
 #ifdef CONFIG_SOFTMMU
 #define assert_memory_lock()
+#define have_exclusive_memory_lock() false
 #else
-#define assert_memory_lock() tcg_debug_assert(have_mmap_lock())
+#define assert_memory_lock() tcg_debug_assert(have_mmap_read_lock())
+#define have_exclusive_memory_lock() have_mmap_lock()
 #endif
 
 #define SMC_BITMAP_USE_THRESHOLD 10
@@ -112,9 +115,7 @@ typedef struct PageDesc {
 #else
     unsigned long flags;
 #endif
-#ifndef CONFIG_USER_ONLY
     QemuSpin lock;
-#endif
 } PageDesc;
 
 /**
@@ -525,15 +526,9 @@ static PageDesc *page_find_alloc(tb_page_addr_t index, int alloc)
             return NULL;
         }
         pd = g_new0(PageDesc, V_L2_SIZE);
-#ifndef CONFIG_USER_ONLY
-        {
-            int i;
-
-            for (i = 0; i < V_L2_SIZE; i++) {
-                qemu_spin_init(&pd[i].lock);
-            }
+        for (i = 0; i < V_L2_SIZE; i++) {
+            qemu_spin_init(&pd[i].lock);
         }
-#endif
         existing = atomic_cmpxchg(lp, NULL, pd);
         if (unlikely(existing)) {
             g_free(pd);
@@ -552,33 +547,6 @@ static inline PageDesc *page_find(tb_page_addr_t index)
 static void page_lock_pair(PageDesc **ret_p1, tb_page_addr_t phys1,
                            PageDesc **ret_p2, tb_page_addr_t phys2, int alloc);
 
-/* In user-mode page locks aren't used; mmap_lock is enough */
-#ifdef CONFIG_USER_ONLY
-
-#define assert_page_locked(pd) tcg_debug_assert(have_mmap_lock())
-
-static inline void page_lock(PageDesc *pd)
-{ }
-
-static inline void page_unlock(PageDesc *pd)
-{ }
-
-static inline void page_lock_tb(const TranslationBlock *tb)
-{ }
-
-static inline void page_unlock_tb(const TranslationBlock *tb)
-{ }
-
-struct page_collection *
-page_collection_lock(tb_page_addr_t start, tb_page_addr_t end)
-{
-    return NULL;
-}
-
-void page_collection_unlock(struct page_collection *set)
-{ }
-#else /* !CONFIG_USER_ONLY */
-
 #ifdef CONFIG_DEBUG_TCG
 
 static __thread GHashTable *ht_pages_locked_debug;
@@ -620,7 +588,7 @@ static void page_unlock__debug(const PageDesc *pd)
 static void
 do_assert_page_locked(const PageDesc *pd, const char *file, int line)
 {
-    if (unlikely(!page_is_locked(pd))) {
+    if (unlikely(!page_is_locked(pd) && !have_exclusive_memory_lock())) {
         error_report("assert_page_lock: PageDesc %p not locked @ %s:%d",
                      pd, file, line);
         abort();
@@ -850,8 +818,6 @@ void page_collection_unlock(struct page_collection *set)
     g_free(set);
 }
 
-#endif /* !CONFIG_USER_ONLY */
-
 static void page_lock_pair(PageDesc **ret_p1, tb_page_addr_t phys1,
                            PageDesc **ret_p2, tb_page_addr_t phys2, int alloc)
 {
@@ -1229,6 +1195,14 @@ static gboolean tb_host_size_iter(gpointer key, gpointer value, gpointer data)
     return false;
 }
 
+/*
+ * Guest PCs of the TBs dropped by region evictions, so that translating
+ * them again can be counted.  Filled with mmap_lock held, and emptied by
+ * the translations under tb_evicted_lock.
+ */
+static GHashTable *tb_evicted_pcs;
+static QemuMutex tb_evicted_lock;
+
 /* flush all the translation blocks */
 static void do_tb_flush(CPUState *cpu, run_on_cpu_data tb_flush_count)
 {
@@ -1257,6 +1231,9 @@ static void do_tb_flush(CPUState *cpu, run_on_cpu_data tb_flush_count)
     page_flush_tb();
 
     tcg_region_reset_all();
+    if (tb_evicted_pcs) {
+        g_hash_table_remove_all(tb_evicted_pcs);
+    }
     /* XXX: flush processor icache at this point if cache flush is
        expensive */
     atomic_mb_set(&tb_ctx.tb_flush_count, tb_ctx.tb_flush_count + 1);
@@ -1274,6 +1251,67 @@ void tb_flush(CPUState *cpu)
     }
 }
 
+static gboolean tb_evict_iter(gpointer key, gpointer value, gpointer data)
+{
+    TranslationBlock *tb = value;
+
+    if (!(tb_cflags(tb) & CF_INVALID)) {
+        g_hash_table_add(tb_evicted_pcs, (gpointer)(uintptr_t)tb->pc);
+        atomic_inc(&tb_ctx.tb_evicted_count);
+    }
+    tb_phys_invalidate(tb, -1);
+    return false;
+}
+
+/* evict the oldest region of code_gen_buffer */
+static void do_tb_evict(CPUState *cpu, run_on_cpu_data tb_evict_count)
+{
+    mmap_lock();
+    /* If it is already been done on request of another CPU,
+     * just retry.
+     */
+    if (tb_ctx.tb_evict_count != tb_evict_count.host_int) {
+        goto done;
+    }
+
+    if (tb_evicted_pcs == NULL) {
+        qemu_mutex_init(&tb_evicted_lock);
+        tb_evicted_pcs = g_hash_table_new(NULL, NULL);
+    }
+    if (tcg_region_evict(tb_evict_iter, NULL)) {
+        CPUState *other;
+
+        /* A TB that lost a race with its invalidation can linger in a jump
+           cache with CF_INVALID set, and tb_phys_invalidate() will not look
+           for it again.  Its memory is about to be reused, so drop it.  */
+        CPU_FOREACH(other) {
+            cpu_tb_jmp_cache_clear(other);
+        }
+        atomic_mb_set(&tb_ctx.tb_evict_count, tb_ctx.tb_evict_count + 1);
+    } else {
+        do_tb_flush(cpu, RUN_ON_CPU_HOST_INT(tb_ctx.tb_flush_count));
+    }
+
+done:
+    mmap_unlock();
+}
+
+/*
+ * Make room once code_gen_buffer is full.  Only the TBs of the oldest region
+ * are dropped if the buffer can be recycled a region at a time; otherwise
+ * everything is flushed.
+ */
+static void tb_make_room(CPUState *cpu)
+{
+    if (tcg_region_can_evict()) {
+        unsigned tb_evict_count = atomic_mb_read(&tb_ctx.tb_evict_count);
+        async_safe_run_on_cpu(cpu, do_tb_evict,
+                              RUN_ON_CPU_HOST_INT(tb_evict_count));
+    } else {
+        tb_flush(cpu);
+    }
+}
+
 /*
  * Formerly ifdef DEBUG_TB_CHECK. These debug functions are user-mode-only,
  * so in order to prevent bit rot we compile them unconditionally in user-mode,
@@ -1324,10 +1362,7 @@ static void tb_page_check(void)
 
 #endif /* CONFIG_USER_ONLY */
 
-/*
- * user-mode: call with mmap_lock held
- * !user-mode: call with @pd->lock held
- */
+/* call with @pd->lock held */
 static inline void tb_page_remove(PageDesc *pd, TranslationBlock *tb)
 {
     TranslationBlock *tb1;
@@ -1422,9 +1457,8 @@ static inline void tb_jmp_unlink(TranslationBlock *dest)
 }
 
 /*
- * In user-mode, call with mmap_lock held.
- * In !user-mode, if @rm_from_page_list is set, call with the TB's pages'
- * locks held.
+ * In user-mode, call with the read side of mmap_lock held.
+ * If @rm_from_page_list is set, call with the TB's pages' locks held.
  */
 static void do_tb_phys_invalidate(TranslationBlock *tb, bool rm_from_page_list)
 {
@@ -1462,10 +1496,16 @@ static void do_tb_phys_invalidate(TranslationBlock *tb, bool rm_from_page_list)
     }
 
     /* remove the TB from the hash list */
-    h = tb_jmp_cache_hash_func(tb->pc);
     CPU_FOREACH(cpu) {
-        if (atomic_read(&cpu->tb_jmp_cache[h]) == tb) {
-            atomic_set(&cpu->tb_jmp_cache[h], NULL);
+        TranslationBlock **set;
+        unsigned int i;
+
+        h = tb_jmp_cache_hash_func(tb->pc, cpu->tb_jmp_cache_bits);
+        set = &cpu->tb_jmp_cache[h * cpu->tb_jmp_cache_ways];
+        for (i = 0; i < cpu->tb_jmp_cache_ways; i++) {
+            if (atomic_read(&set[i]) == tb) {
+                atomic_set(&set[i], NULL);
+            }
         }
     }
 
@@ -1476,8 +1516,8 @@ static void do_tb_phys_invalidate(TranslationBlock *tb, bool rm_from_page_list)
     /* suppress any remaining jumps to this TB */
     tb_jmp_unlink(tb);
 
-    atomic_set(&tcg_ctx->tb_phys_invalidate_count,
-               tcg_ctx->tb_phys_invalidate_count + 1);
+    /* Outside of translations, threads share tcg_idle_ctx in user-mode */
+    atomic_inc(&tcg_ctx->tb_phys_invalidate_count);
 }
 
 static void tb_phys_invalidate__locked(TranslationBlock *tb)
@@ -1487,7 +1527,7 @@ static void tb_phys_invalidate__locked(TranslationBlock *tb)
 
 /* invalidate one TB
  *
- * Called with mmap_lock held in user-mode.
+ * Called with the read side of mmap_lock held in user-mode.
  */
 void tb_phys_invalidate(TranslationBlock *tb, tb_page_addr_t page_addr)
 {
@@ -1531,8 +1571,7 @@ static void build_page_bitmap(PageDesc *p)
 
 /* add the tb in the target page and protect it if necessary
  *
- * Called with mmap_lock held for user-mode emulation.
- * Called with @p->lock held in !user-mode.
+ * Called with @p->lock held.
  */
 static inline void tb_page_add(PageDesc *p, TranslationBlock *tb,
                                unsigned int n, tb_page_addr_t page_addr)
@@ -1552,13 +1591,14 @@ static inline void tb_page_add(PageDesc *p, TranslationBlock *tb,
     invalidate_page_bitmap(p);
 
 #if defined(CONFIG_USER_ONLY)
-    if (p->flags & PAGE_WRITE) {
+    if (atomic_read(&p->flags) & PAGE_WRITE) {
         target_ulong addr;
         PageDesc *p2;
         int prot;
 
         /* force the host page as non writable (writes will have a
-           page fault + mprotect overhead) */
+           page fault + mprotect overhead).  The other target pages of
+           the host page may be translated from at the same time.  */
         page_addr &= qemu_host_page_mask;
         prot = 0;
         for (addr = page_addr; addr < page_addr + qemu_host_page_size;
@@ -1568,8 +1608,7 @@ static inline void tb_page_add(PageDesc *p, TranslationBlock *tb,
             if (!p2) {
                 continue;
             }
-            prot |= p2->flags;
-            p2->flags &= ~PAGE_WRITE;
+            prot |= atomic_fetch_and(&p2->flags, ~PAGE_WRITE);
           }
         mprotect(g2h(page_addr), qemu_host_page_size,
                  (prot & PAGE_BITS) & ~PAGE_WRITE);
@@ -1590,12 +1629,12 @@ static inline void tb_page_add(PageDesc *p, TranslationBlock *tb,
 /* add a new TB and link it to the physical page tables. phys_page2 is
  * (-1) to indicate that only one page contains the TB.
  *
- * Called with mmap_lock held for user-mode emulation.
+ * Called with the read side of mmap_lock held for user-mode emulation.
  *
  * Returns a pointer @tb, or a pointer to an existing TB that matches @tb.
- * Note that in !user-mode, another thread might have already added a TB
- * for the same block of guest code that @tb corresponds to. In that case,
- * the caller should discard the original @tb, and use instead the returned TB.
+ * Note that another thread might have already added a TB for the same block
+ * of guest code that @tb corresponds to. In that case, the caller should
+ * discard the original @tb, and use instead the returned TB.
  */
 static TranslationBlock *
 tb_link_page(TranslationBlock *tb, tb_page_addr_t phys_pc,
@@ -1667,7 +1706,10 @@ tb_link_page(TranslationBlock *tb, tb_page_addr_t phys_pc,
     return tb;
 }
 
-/* Called with mmap_lock held for user mode emulation.  */
+/*
+ * Called with the read side of mmap_lock held for user mode emulation.
+ * The code is generated with a context of the pool, see tcg_ctx_acquire().
+ */
 TranslationBlock *tb_gen_code(CPUState *cpu,
                               target_ulong pc, target_ulong cs_base,
                               uint32_t flags, int cflags)
@@ -1679,7 +1721,7 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
     tcg_insn_unit *gen_code_buf;
     int gen_code_size, search_size;
 #ifdef CONFIG_PROFILER
-    TCGProfile *prof = &tcg_ctx->prof;
+    TCGProfile *prof;
     int64_t ti;
 #endif
     assert_memory_lock();
@@ -1692,12 +1734,17 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
         cflags |= CF_NOCACHE | 1;
     }
 
+    tcg_ctx_acquire();
+#ifdef CONFIG_PROFILER
+    prof = &tcg_ctx->prof;
+#endif
  buffer_overflow:
     tb = tb_alloc(pc);
     if (unlikely(!tb)) {
-        /* flush must be done */
-        tb_flush(cpu);
-        mmap_unlock();
+        /* eviction or flush must be done */
+        tcg_ctx_release();
+        tb_make_room(cpu);
+        mmap_read_unlock();
         /* Make the execution loop process the flush as soon as possible.  */
         cpu->exception_index = EXCP_INTERRUPT;
         cpu_loop_exit(cpu);
@@ -1792,6 +1839,10 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
         } else {
             log_disas(tb->tc.ptr, gen_code_size);
         }
+        if (tcg_ctx->tb_cold_size) {
+            qemu_log("OUT (cold): [size=%zu]\n", tcg_ctx->tb_cold_size);
+            log_disas(tcg_ctx->tb_cold_ptr, tcg_ctx->tb_cold_size);
+        }
         qemu_log("\n");
         qemu_log_flush();
         qemu_log_unlock();
@@ -1835,16 +1886,39 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
 
         orig_aligned -= ROUND_UP(sizeof(*tb), qemu_icache_linesize);
         atomic_set(&tcg_ctx->code_gen_ptr, (void *)orig_aligned);
+        tcg_ctx_release();
         return existing_tb;
     }
+    perf_report_code(tb);
+    tcg_ctx_release();
     tcg_tb_insert(tb);
+    if (unlikely(tb_evicted_pcs)) {
+        qemu_mutex_lock(&tb_evicted_lock);
+        if (g_hash_table_remove(tb_evicted_pcs, (gpointer)(uintptr_t)pc)) {
+            atomic_inc(&tb_ctx.tb_retranslate_count);
+        }
+        qemu_mutex_unlock(&tb_evicted_lock);
+    }
     return tb;
 }
 
+/*
+ * A guest fault while reading the code to translate longjmp()s out of
+ * tb_gen_code().  Called after the sigsetjmp() of the execution loop, this
+ * gives the context back to the pool and drops the read side of mmap_lock,
+ * as tb_gen_code() and its caller would have done.
+ */
+void tb_gen_code_cleanup(void)
+{
+#ifdef CONFIG_USER_ONLY
+    tcg_ctx_release();
+    mmap_read_unlock_all();
+#endif
+}
+
 /*
  * @p must be non-NULL.
- * user-mode: call with mmap_lock held.
- * !user-mode: call with all @pages locked.
+ * Call with all @pages locked, and in user-mode with mmap_lock held.
  */
 static void
 tb_invalidate_phys_page_range__locked(struct page_collection *pages,
@@ -2200,9 +2274,12 @@ void cpu_io_recompile(CPUState *cpu, uintptr_t retaddr)
 
 static void tb_jmp_cache_clear_page(CPUState *cpu, target_ulong page_addr)
 {
-    unsigned int i, i0 = tb_jmp_cache_hash_page(page_addr);
+    unsigned int bits = cpu->tb_jmp_cache_bits;
+    unsigned int ways = cpu->tb_jmp_cache_ways;
+    unsigned int i, i0 = tb_jmp_cache_hash_page(page_addr, bits) * ways;
+    unsigned int n = ways << tb_jmp_cache_page_bits(bits);
 
-    for (i = 0; i < TB_JMP_PAGE_SIZE; i++) {
+    for (i = 0; i < n; i++) {
         atomic_set(&cpu->tb_jmp_cache[i0 + i], NULL);
     }
 }
@@ -2286,6 +2363,24 @@ static gboolean tb_tree_stats_iter(gpointer key, gpointer value, gpointer data)
     return false;
 }
 
+static void print_jmp_cache_statistics(FILE *f, fprintf_function cpu_fprintf)
+{
+    CPUState *cpu;
+
+    CPU_FOREACH(cpu) {
+        size_t hits = atomic_read(&cpu->tb_jmp_cache_hits);
+        size_t misses = atomic_read(&cpu->tb_jmp_cache_misses);
+        size_t lookups = hits + misses;
+
+        cpu_fprintf(f, "jump cache CPU %-4d %u sets x %u ways, %zu hits "
+                    "(%zu%%), %zu misses, %zu conflicts\n",
+                    cpu->cpu_index, 1u << cpu->tb_jmp_cache_bits,
+                    cpu->tb_jmp_cache_ways, hits,
+                    lookups ? hits * 100 / lookups : 0, misses,
+                    atomic_read(&cpu->tb_jmp_cache_conflicts));
+    }
+}
+
 void dump_exec_info(FILE *f, fprintf_function cpu_fprintf)
 {
     struct tb_tree_stats tst = {};
@@ -2321,12 +2416,18 @@ void dump_exec_info(FILE *f, fprintf_function cpu_fprintf)
     qht_statistics_init(&tb_ctx.htable, &hst);
     print_qht_statistics(f, cpu_fprintf, hst);
     qht_statistics_destroy(&hst);
+    print_jmp_cache_statistics(f, cpu_fprintf);
 
     cpu_fprintf(f, "\nStatistics:\n");
     cpu_fprintf(f, "TB flush count      %u\n",
                 atomic_read(&tb_ctx.tb_flush_count));
+    cpu_fprintf(f, "TB region evictions %u (%zu TBs, %zu retranslated)\n",
+                atomic_read(&tb_ctx.tb_evict_count),
+                atomic_read(&tb_ctx.tb_evicted_count),
+                atomic_read(&tb_ctx.tb_retranslate_count));
     cpu_fprintf(f, "TB invalidate count %zu\n", tcg_tb_phys_invalidate_count());
     cpu_fprintf(f, "TLB flush count     %zu\n", tlb_flush_count());
+    cpu_fprintf(f, "TLB resize count    %zu\n", tlb_resize_count());
     tcg_dump_info(f, cpu_fprintf);
 }
 
@@ -2481,7 +2582,8 @@ void page_set_flags(target_ulong start, target_ulong end, int flags)
     assert(end <= ((target_ulong)1 << L1_MAP_ADDR_SPACE_BITS));
 #endif
     assert(start < end);
-    assert_memory_lock();
+    /* The translations read the flags with the read side held */
+    tcg_debug_assert(have_mmap_lock());
 
     start = start & TARGET_PAGE_MASK;
     end = TARGET_PAGE_ALIGN(end);
@@ -926,6 +926,9 @@ void cpu_exec_unrealizefn(CPUState *cpu)
 #ifndef CONFIG_USER_ONLY
     tcg_iommu_free_notifier_list(cpu);
 #endif
+    if (tcg_enabled()) {
+        tlb_destroy(cpu);
+    }
 }
 
 Property cpu_common_props[] = {
@@ -965,6 +968,9 @@ void cpu_exec_realizefn(CPUState *cpu, Error **errp)
         tcg_target_initialized = true;
         cc->tcg_initialize();
     }
+    if (tcg_enabled()) {
+        tlb_init(cpu);
+    }
 
 #ifndef CONFIG_USER_ONLY
     if (qdev_get_vmsd(DEVICE(cpu)) == NULL) {
@@ -35,6 +35,9 @@ struct TBContext {
 
     /* statistics */
     unsigned tb_flush_count;
+    unsigned tb_evict_count;      /* code regions evicted */
+    size_t tb_evicted_count;      /* TBs dropped by those evictions */
+    size_t tb_retranslate_count;  /* evicted TBs translated again */
 };
 
 extern TBContext tb_ctx;
@@ -16,31 +16,66 @@
 #include "exec/exec-all.h"
 #include "exec/tb-hash.h"
 
+static inline TranslationBlock **tb_jmp_cache_set(CPUState *cpu,
+                                                  target_ulong pc)
+{
+    unsigned int set = tb_jmp_cache_hash_func(pc, cpu->tb_jmp_cache_bits);
+
+    return &cpu->tb_jmp_cache[set * cpu->tb_jmp_cache_ways];
+}
+
+/* Make @tb the most recently used entry of @set, dropping the least
+   recently used one.  Only called by the vCPU thread that owns @set.  */
+static inline void tb_jmp_cache_insert(CPUState *cpu, TranslationBlock **set,
+                                       TranslationBlock *tb)
+{
+    unsigned int i = cpu->tb_jmp_cache_ways - 1;
+
+    if (atomic_read(&set[i])) {
+        atomic_set(&cpu->tb_jmp_cache_conflicts,
+                   cpu->tb_jmp_cache_conflicts + 1);
+    }
+    for (; i > 0; i--) {
+        atomic_set(&set[i], atomic_read(&set[i - 1]));
+    }
+    atomic_set(&set[0], tb);
+}
+
 /* Might cause an exception, so have a longjmp destination ready */
 static inline TranslationBlock *
 tb_lookup__cpu_state(CPUState *cpu, target_ulong *pc, target_ulong *cs_base,
                      uint32_t *flags, uint32_t cf_mask)
 {
     CPUArchState *env = (CPUArchState *)cpu->env_ptr;
-    TranslationBlock *tb;
-    uint32_t hash;
+    TranslationBlock *tb, **set;
+    unsigned int i;
 
     cpu_get_tb_cpu_state(env, pc, cs_base, flags);
-    hash = tb_jmp_cache_hash_func(*pc);
-    tb = atomic_rcu_read(&cpu->tb_jmp_cache[hash]);
-    if (likely(tb &&
-               tb->pc == *pc &&
-               tb->cs_base == *cs_base &&
-               tb->flags == *flags &&
-               tb->trace_vcpu_dstate == *cpu->trace_dstate &&
-               (tb_cflags(tb) & (CF_HASH_MASK | CF_INVALID)) == cf_mask)) {
-        return tb;
+    set = tb_jmp_cache_set(cpu, *pc);
+    for (i = 0; i < cpu->tb_jmp_cache_ways; i++) {
+        tb = atomic_rcu_read(&set[i]);
+        if (likely(tb &&
+                   tb->pc == *pc &&
+                   tb->cs_base == *cs_base &&
+                   tb->flags == *flags &&
+                   tb->trace_vcpu_dstate == *cpu->trace_dstate &&
+                   (tb_cflags(tb) & (CF_HASH_MASK | CF_INVALID)) == cf_mask)) {
+            /* Swapping with the first way is enough to keep hot TBs
+               away from the end of the set, where victims are taken */
+            if (i > 0) {
+                atomic_set(&set[i], atomic_read(&set[0]));
+                atomic_set(&set[0], tb);
+            }
+            atomic_set(&cpu->tb_jmp_cache_hits, cpu->tb_jmp_cache_hits + 1);
+            return tb;
+        }
     }
+    atomic_set(&cpu->tb_jmp_cache_misses, cpu->tb_jmp_cache_misses + 1);
     tb = tb_htable_lookup(cpu, *pc, *cs_base, *flags, cf_mask);
     if (tb == NULL) {
         return NULL;
     }
-    atomic_set(&cpu->tb_jmp_cache[hash], tb);
+    tb_jmp_cache_insert(cpu, set, tb);
     return tb;
 }
 
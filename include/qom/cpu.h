@@ -248,8 +248,14 @@ struct kvm_run;
 
 struct hax_vcpu_state;
 
+/* Default shape of the jump cache: 1 << TB_JMP_CACHE_BITS entries in total,
+   grouped in sets of TB_JMP_CACHE_WAYS.  Can be changed with
+   cpu_tb_jmp_cache_set_shape() before the vCPUs are created.  */
 #define TB_JMP_CACHE_BITS 12
-#define TB_JMP_CACHE_SIZE (1 << TB_JMP_CACHE_BITS)
+#define TB_JMP_CACHE_WAYS 2
+#define TB_JMP_CACHE_MIN_BITS 8
+#define TB_JMP_CACHE_MAX_BITS 16
+#define TB_JMP_CACHE_MAX_WAYS 4
 
 /* work queue */
 
@@ -366,8 +372,16 @@ struct CPUState {
 
     void *env_ptr; /* CPUArchState */
 
-    /* Accessed in parallel; all accesses must be atomic */
-    struct TranslationBlock *tb_jmp_cache[TB_JMP_CACHE_SIZE];
+    /* 1 << tb_jmp_cache_bits sets of tb_jmp_cache_ways entries each, the
+       most recently used first.  Accessed in parallel; all accesses to the
+       entries must be atomic */
+    struct TranslationBlock **tb_jmp_cache;
+    unsigned int tb_jmp_cache_bits;
+    unsigned int tb_jmp_cache_ways;
+    /* Only updated by the vCPU thread */
+    size_t tb_jmp_cache_hits;
+    size_t tb_jmp_cache_misses;
+    size_t tb_jmp_cache_conflicts;
 
     struct GDBRegisterState *gdb_regs;
     int gdb_num_regs;
@@ -453,9 +467,9 @@ extern __thread CPUState *current_cpu;
 
 static inline void cpu_tb_jmp_cache_clear(CPUState *cpu)
 {
-    unsigned int i;
+    size_t i, n = (size_t)cpu->tb_jmp_cache_ways << cpu->tb_jmp_cache_bits;
 
-    for (i = 0; i < TB_JMP_CACHE_SIZE; i++) {
+    for (i = 0; i < n; i++) {
         atomic_set(&cpu->tb_jmp_cache[i], NULL);
     }
 }
@@ -806,6 +820,16 @@ bool cpu_exists(int64_t id);
  */
 CPUState *cpu_by_arch_id(int64_t id);
 
+/**
+ * cpu_tb_jmp_cache_set_shape:
+ * @str: Number of jump cache entries per vCPU, a power of 2, optionally
+ * followed by a comma and the number of ways, 1, 2 or 4.
+ * @errp: pointer to error object
+ *
+ * Set the shape of the jump caches of the vCPUs created from now on.
+ */
+void cpu_tb_jmp_cache_set_shape(const char *str, Error **errp);
+
 /**
  * cpu_throttle_set:
  * @new_throttle_pct: Percent of sleep time. Valid range is 1 to 99.
@@ -18,6 +18,7 @@
  */
 #include "qemu/osdep.h"
 #include "qemu.h"
+#include "accel/tcg/perf.h"
 
 #ifdef CONFIG_GCOV
 extern void __gcov_dump(void);
@@ -32,4 +33,9 @@ void preexit_cleanup(CPUArchState *env, int code)
         __gcov_dump();
 #endif
         gdb_exit(env, code);
+        perf_exit();
+#ifdef TARGET_HEXAGON
+        hexagon_profile_dump();
+        hexagon_warm_cache_save();
+#endif
 }
@@ -25,6 +25,7 @@ void cpu_loop(CPUHexagonState *env)
 {
     CPUState *cs = CPU(hexagon_env_get_cpu(env));
     int trapnr;
+    abi_long ret;
     target_siginfo_t info;
 
     while (1) {
@@ -48,6 +49,31 @@ void cpu_loop(CPUHexagonState *env)
             /* Semihosing syscall.  */
             env->cr[CR_PC] += 4;
             env->gpr[0] = do_hexagon_semihosting(env);
+            hexagon_trace_syscall(env);
+            break;
+        case EXCP_SYSCALL:
+            /*
+             * Linux syscall, trap0(#1): number in r6, arguments in r0-r5,
+             * result in r0.  The trap has set ELR to the address of the next
+             * packet, a restarted syscall runs the trapping packet again.
+             */
+            env->cr[CR_PC] = env->sr[3];
+            ret = do_syscall(env, env->gpr[6],
+                             env->gpr[0], env->gpr[1], env->gpr[2],
+                             env->gpr[3], env->gpr[4], env->gpr[5],
+                             0, 0);
+            if (ret == -TARGET_ERESTARTSYS) {
+                env->cr[CR_PC] = env->trap_pc;
+                break;
+            }
+            if (ret != -TARGET_QEMU_ESIGRETURN) {
+                env->gpr[0] = ret;
+            }
+            hexagon_trace_syscall(env);
+            break;
+        case EXCP_SNAPSHOT:
+            /* Restore point given with -hexagon-snapshot */
+            hexagon_snapshot_restore(env);
             break;
         default:
             //printf ("Unhandled trap: 0x%x\n", trapnr);
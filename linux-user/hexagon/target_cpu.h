@@ -25,6 +25,8 @@ static inline void cpu_clone_regs(CPUHexagonState *env, target_ulong newsp)
         env->cr[GPR_SP] = newsp;
     }
     env->gpr[0] = 0;
+    /* The new thread gets its own trace file */
+    hexagon_trace_cpu_reset(env);
 }
 
 static inline void cpu_set_tls(CPUHexagonState *env, target_ulong newtls)
@@ -31,6 +31,7 @@
 #include "cpu.h"
 #include "exec/exec-all.h"
 #include "tcg.h"
+#include "accel/tcg/perf.h"
 #include "qemu/timer.h"
 #include "qemu/envlist.h"
 #include "elf.h"
@@ -371,6 +372,64 @@ static void handle_arg_strace(const char *arg)
     do_strace = 1;
 }
 
+static void handle_arg_perfmap(const char *arg)
+{
+    perf_enable_perfmap();
+}
+
+static void handle_arg_jitdump(const char *arg)
+{
+    perf_enable_jitdump();
+}
+
+static void handle_arg_jmp_cache(const char *arg)
+{
+    Error *err = NULL;
+
+    cpu_tb_jmp_cache_set_shape(arg, &err);
+    if (err) {
+        error_report_err(err);
+        exit(EXIT_FAILURE);
+    }
+}
+
+#if defined(TARGET_HEXAGON)
+static void handle_arg_hexagon_profile(const char *arg)
+{
+    hexagon_profile_init(arg);
+}
+
+static void handle_arg_hexagon_trace(const char *arg)
+{
+    hexagon_trace_init(arg);
+}
+
+static void handle_arg_hexagon_lockstep(const char *arg)
+{
+    hexagon_lockstep_init(arg);
+}
+
+static void handle_arg_hexagon_snapshot(const char *arg)
+{
+    hexagon_snapshot_init(arg);
+}
+
+static void handle_arg_hexagon_superblock(const char *arg)
+{
+    hexagon_superblock_init();
+}
+
+static void handle_arg_hexagon_tier(const char *arg)
+{
+    hexagon_tier_init(arg);
+}
+
+static void handle_arg_hexagon_warm_cache(const char *arg)
+{
+    hexagon_warm_cache_init(arg);
+}
+#endif
+
 static void handle_arg_version(const char *arg)
 {
     printf("qemu-" TARGET_NAME " version " QEMU_FULL_VERSION
@@ -432,6 +491,34 @@ static const struct qemu_argument arg_table[] = {
      "",           "run in singlestep mode"},
     {"strace",     "QEMU_STRACE",      false, handle_arg_strace,
      "",           "log system calls"},
+    {"perfmap",    "QEMU_PERFMAP",     false, handle_arg_perfmap,
+     "",           "Generate a /tmp/perf-${pid}.map file for perf"},
+    {"jitdump",    "QEMU_JITDUMP",     false, handle_arg_jitdump,
+     "",           "Generate a jit-${pid}.dump file for perf"},
+    {"jmp-cache",  "QEMU_JMP_CACHE",   true,  handle_arg_jmp_cache,
+     "size[,ways]", "set the TB jump cache size and associativity"},
+#if defined(TARGET_HEXAGON)
+    {"hexagon-profile", "QEMU_HEXAGON_PROFILE", true,
+     handle_arg_hexagon_profile,
+     "mode[,prefix=file]", "profile execution, mode is count or sample[=usec]"},
+    {"hexagon-trace", "QEMU_HEXAGON_TRACE", true, handle_arg_hexagon_trace,
+     "prefix[,size=MiB]", "write a binary packet trace to prefix.<tid>"},
+    {"hexagon-lockstep", "QEMU_HEXAGON_LOCKSTEP", true,
+     handle_arg_hexagon_lockstep,
+     "file",       "compare execution against a reference trace"},
+    {"hexagon-snapshot", "QEMU_HEXAGON_SNAPSHOT", true,
+     handle_arg_hexagon_snapshot,
+     "take=addr[,restore=addr]",
+     "snapshot the guest at take, rewind to it at restore"},
+    {"hexagon-superblock", "QEMU_HEXAGON_SUPERBLOCK", false,
+     handle_arg_hexagon_superblock,
+     "",           "translate hot paths across biased branches"},
+    {"hexagon-tier", "QEMU_HEXAGON_TIER", true, handle_arg_hexagon_tier,
+     "count",      "optimize blocks only once run count times"},
+    {"hexagon-warm-cache", "QEMU_HEXAGON_WARM_CACHE", true,
+     handle_arg_hexagon_warm_cache,
+     "file",       "keep the hot blocks and branches across runs in file"},
+#endif
     {"seed",       "QEMU_RAND_SEED",   true,  handle_arg_randseed,
      "",           "Seed for pseudo-random number generator"},
     {"trace",      "QEMU_TRACE",       true,  handle_arg_trace,
@@ -23,20 +23,60 @@
 
 //#define DEBUG_MMAP
 
-static pthread_mutex_t mmap_mutex = PTHREAD_MUTEX_INITIALIZER;
+/*
+ * The guest memory layout is changed with mmap_lock held, which excludes
+ * everybody else.  Translations only need it to stay put, and take the read
+ * side, so that threads can translate in parallel; the TB lists of the pages
+ * are protected by the page locks in translate-all.c.  The read side cannot
+ * be upgraded, but is a no-op within mmap_lock.
+ *
+ * So nothing reached from tb_gen_code() or tb_lookup may take mmap_lock:
+ * neither page_set_flags(), nor tb_invalidate_phys_range(), nor a flush,
+ * which tb_gen_code() defers with async_safe_run_on_cpu().  Helpers and
+ * page_unprotect() only run outside of translations, since these only
+ * read guest code.  mmap_lock() asserts that the read side is not held.
+ */
+static pthread_rwlock_t mmap_rwlock = PTHREAD_RWLOCK_INITIALIZER;
 static __thread int mmap_lock_count;
+static __thread int mmap_read_lock_count;
 
 void mmap_lock(void)
 {
     if (mmap_lock_count++ == 0) {
-        pthread_mutex_lock(&mmap_mutex);
+        assert(mmap_read_lock_count == 0);
+        pthread_rwlock_wrlock(&mmap_rwlock);
     }
 }
 
 void mmap_unlock(void)
 {
     if (--mmap_lock_count == 0) {
-        pthread_mutex_unlock(&mmap_mutex);
+        assert(mmap_read_lock_count == 0);
+        pthread_rwlock_unlock(&mmap_rwlock);
+    }
+}
+
+void mmap_read_lock(void)
+{
+    if (mmap_read_lock_count++ == 0 && mmap_lock_count == 0) {
+        pthread_rwlock_rdlock(&mmap_rwlock);
+    }
+}
+
+void mmap_read_unlock(void)
+{
+    if (--mmap_read_lock_count == 0 && mmap_lock_count == 0) {
+        pthread_rwlock_unlock(&mmap_rwlock);
+    }
+}
+
+/* Drop the read side, however many times it was taken, after a guest fault
+   longjmp()ed out of the code holding it */
+void mmap_read_unlock_all(void)
+{
+    if (mmap_read_lock_count > 0) {
+        mmap_read_lock_count = 1;
+        mmap_read_unlock();
     }
 }
 
@@ -45,20 +85,25 @@ bool have_mmap_lock(void)
     return mmap_lock_count > 0 ? true : false;
 }
 
+bool have_mmap_read_lock(void)
+{
+    return mmap_lock_count > 0 || mmap_read_lock_count > 0;
+}
+
 /* Grab lock to make sure things are in a consistent state after fork().  */
 void mmap_fork_start(void)
 {
-    if (mmap_lock_count)
+    if (mmap_lock_count || mmap_read_lock_count)
         abort();
-    pthread_mutex_lock(&mmap_mutex);
+    pthread_rwlock_wrlock(&mmap_rwlock);
 }
 
 void mmap_fork_end(int child)
 {
     if (child)
-        pthread_mutex_init(&mmap_mutex, NULL);
+        pthread_rwlock_init(&mmap_rwlock, NULL);
     else
-        pthread_mutex_unlock(&mmap_mutex);
+        pthread_rwlock_unlock(&mmap_rwlock);
 }
 
 /* NOTE: all the constants are the HOST ones, but addresses are target. */
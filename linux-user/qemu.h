@@ -201,6 +201,8 @@ int load_flt_binary(struct linux_binprm *bprm, struct image_info *info);
 abi_long memcpy_to_target(abi_ulong dest, const void *src,
                           unsigned long len);
 void target_set_brk(abi_ulong new_brk);
+void target_get_brk(abi_ulong *brk, abi_ulong *page);
+void target_restore_brk(abi_ulong brk, abi_ulong page);
 abi_long do_brk(abi_ulong new_brk);
 void syscall_init(void);
 abi_long do_syscall(void *cpu_env, int num, abi_long arg1,
@@ -497,6 +497,9 @@ static inline int regpairs_aligned(void *cpu_env, int num)
 }
 #elif defined(TARGET_XTENSA)
 static inline int regpairs_aligned(void *cpu_env, int num) { return 1; }
+#elif defined(TARGET_HEXAGON)
+/* Hexagon passes 64bit types in even/odd register pairs */
+static inline int regpairs_aligned(void *cpu_env, int num) { return 1; }
 #else
 static inline int regpairs_aligned(void *cpu_env, int num) { return 0; }
 #endif
@@ -872,6 +875,19 @@ void target_set_brk(abi_ulong new_brk)
     brk_page = HOST_PAGE_ALIGN(target_brk);
 }
 
+/* Used to rewind the heap together with the guest memory, e.g. by snapshots */
+void target_get_brk(abi_ulong *brk, abi_ulong *page)
+{
+    *brk = target_brk;
+    *page = brk_page;
+}
+
+void target_restore_brk(abi_ulong brk, abi_ulong page)
+{
+    target_brk = brk;
+    brk_page = page;
+}
+
 //#define DEBUGF_BRK(message, args...) do { fprintf(stderr, (message), ## args); } while (0)
 #define DEBUGF_BRK(message, args...)
 
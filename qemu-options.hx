@@ -3637,6 +3637,19 @@ STEXI
 Set TB size.
 ETEXI
 
+DEF("tb-jmp-cache", HAS_ARG, QEMU_OPTION_tb_jmp_cache, \
+    "-tb-jmp-cache size[,ways]\n"
+    "                set the size and associativity of each vCPU's TB jump cache\n",
+    QEMU_ARCH_ALL)
+STEXI
+@item -tb-jmp-cache @var{size}[,@var{ways}]
+@findex -tb-jmp-cache
+Give each vCPU a TB jump cache of @var{size} entries, a power of 2 between
+256 and 65536 (default 4096), grouped in sets of @var{ways} entries, 1, 2
+or 4 (default 2).  The per-vCPU hit, miss and conflict counts are shown by
+the @code{info jit} monitor command.
+ETEXI
+
 DEF("incoming", HAS_ARG, QEMU_OPTION_incoming, \
     "-incoming tcp:[host]:port[,to=maxport][,ipv4][,ipv6]\n" \
     "-incoming rdma:host:port[,ipv4][,ipv6]\n" \
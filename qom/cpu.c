@@ -28,6 +28,8 @@
 #include "exec/log.h"
 #include "exec/cpu-common.h"
 #include "qemu/error-report.h"
+#include "qemu/cutils.h"
+#include "qemu/host-utils.h"
 #include "sysemu/sysemu.h"
 #include "hw/boards.h"
 #include "hw/qdev-properties.h"
@@ -35,6 +37,36 @@
 
 CPUInterruptHandler cpu_interrupt_handler;
 
+/* Shape of the jump cache of new vCPUs: log2 of its size, and set size */
+static unsigned int tb_jmp_cache_bits = TB_JMP_CACHE_BITS;
+static unsigned int tb_jmp_cache_ways = TB_JMP_CACHE_WAYS;
+
+void cpu_tb_jmp_cache_set_shape(const char *str, Error **errp)
+{
+    unsigned int entries, ways = TB_JMP_CACHE_WAYS;
+    const char *end;
+
+    if (qemu_strtoui(str, &end, 0, &entries) < 0 ||
+        (*end && (*end != ',' || qemu_strtoui(end + 1, NULL, 0, &ways) < 0))) {
+        error_setg(errp, "invalid jump cache size '%s'", str);
+        return;
+    }
+    if (!is_power_of_2(entries) ||
+        entries < (1u << TB_JMP_CACHE_MIN_BITS) ||
+        entries > (1u << TB_JMP_CACHE_MAX_BITS)) {
+        error_setg(errp, "jump cache size must be a power of 2 between %u "
+                   "and %u", 1u << TB_JMP_CACHE_MIN_BITS,
+                   1u << TB_JMP_CACHE_MAX_BITS);
+        return;
+    }
+    if (!is_power_of_2(ways) || ways > TB_JMP_CACHE_MAX_WAYS) {
+        error_setg(errp, "jump cache associativity must be 1, 2 or 4");
+        return;
+    }
+    tb_jmp_cache_bits = ctz32(entries);
+    tb_jmp_cache_ways = ways;
+}
+
 CPUState *cpu_by_arch_id(int64_t id)
 {
     CPUState *cpu;
@@ -376,11 +408,19 @@ static void cpu_common_initfn(Object *obj)
     QTAILQ_INIT(&cpu->breakpoints);
     QTAILQ_INIT(&cpu->watchpoints);
 
+    cpu->tb_jmp_cache_bits = tb_jmp_cache_bits - ctz32(tb_jmp_cache_ways);
+    cpu->tb_jmp_cache_ways = tb_jmp_cache_ways;
+    cpu->tb_jmp_cache = g_new0(struct TranslationBlock *,
+                               1u << tb_jmp_cache_bits);
+
     cpu_exec_initfn(cpu);
 }
 
 static void cpu_common_finalize(Object *obj)
 {
+    CPUState *cpu = CPU(obj);
+
+    g_free(cpu->tb_jmp_cache);
 }
 
 static int64_t cpu_common_get_arch_id(CPUState *cpu)
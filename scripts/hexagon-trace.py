@@ -0,0 +1,160 @@
+#!/usr/bin/env python3
+#
+# Pretty-printer for qemu-hexagon -hexagon-trace ring files, and converter
+# to the reference traces read by -hexagon-lockstep
+#
+# This work is licensed under the terms of the GNU GPL, version 2 or later.
+# See the COPYING file in the top-level directory.
+#
+# The file layout is described in target/hexagon/exec-trace.h.
+
+import argparse
+import collections
+import mmap
+import struct
+import sys
+
+MAGIC = b"HEXTRACE"
+REF_MAGIC = b"HEXTREF\0"
+VERSION = 1
+HEADER_SIZE = 4096
+HEADER_FMT = "=8sIIII"
+CHUNK_FMT = "=II"
+REF_HEADER_FMT = "=8sII"
+RECORD_FMT = "=IIII"
+
+CR_NAMES = ["sa0", "lc0", "sa1", "lc1", "p3:0", "c5", "m0", "m1",
+            "usr", "pc", "ugp", "gp", "cs0", "cs1", "upcyclelo",
+            "upcyclehi", "framelimit", "framekey", "pktcountlo",
+            "pktcounthi"] + ["c%d" % i for i in range(20, 30)] + \
+           ["utimerlo", "utimerhi"]
+REG_INDEX = dict([("r%d" % i, i) for i in range(32)] +
+                 [("c%d" % i, 32 + i) for i in range(32)] +
+                 [(name, 32 + i) for i, name in enumerate(CR_NAMES)])
+
+
+class Packet(object):
+    __slots__ = ("pc", "regs", "mem")
+
+    def __init__(self, pc, regs, mem):
+        self.pc = pc
+        # List of (name, value), GPRs first, in register order
+        self.regs = regs
+        # Load/store addresses, 0 for accesses skipped by a false predicate
+        self.mem = mem
+
+    def encode(self):
+        regs = sorted((REG_INDEX[name], value) for name, value in self.regs)
+        mask = 0
+        for index, _ in regs:
+            mask |= 1 << index
+        values = [value for _, value in regs] + self.mem
+        return struct.pack(RECORD_FMT + "%dI" % len(values), self.pc,
+                           mask & 0xffffffff, mask >> 32, len(self.mem),
+                           *values)
+
+    @classmethod
+    def parse(cls, line):
+        """Parse a line in the format printed by this script."""
+        fields = line.split()
+        regs, mem = [], []
+        for field in fields[1:]:
+            name, value = field.split("=", 1)
+            if name == "mem":
+                mem = [int(addr, 0) for addr in value.split(",")]
+            else:
+                regs.append((name, int(value, 0)))
+        return cls(int(fields[0], 0), regs, mem)
+
+    def __str__(self):
+        text = "0x%08x" % self.pc
+        for name, value in self.regs:
+            text += " %s=0x%08x" % (name, value)
+        if self.mem:
+            text += " mem=" + ",".join("0x%08x" % a for a in self.mem)
+        return text
+
+
+def _mask_names(mask, names):
+    return [names[i] for i in range(32) if mask & (1 << i)]
+
+
+def _parse_chunk(buf, start, end):
+    pos = start
+    rec_size = struct.calcsize(RECORD_FMT)
+    while pos + rec_size <= end:
+        pc, gpr_mask, cr_mask, nmem = struct.unpack_from(RECORD_FMT, buf, pos)
+        pos += rec_size
+        names = _mask_names(gpr_mask, ["r%d" % i for i in range(32)]) + \
+                _mask_names(cr_mask, CR_NAMES)
+        values = struct.unpack_from("=%dI" % (len(names) + nmem), buf, pos)
+        pos += 4 * len(values)
+        yield Packet(pc, list(zip(names, values)), list(values[len(names):]))
+
+
+def read_trace(path):
+    """Yield the packets of a ring file, oldest first."""
+    with open(path, "rb") as f:
+        buf = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+    magic, version, chunk_size, nchunks, _ = \
+        struct.unpack_from(HEADER_FMT, buf, 0)
+    if magic != MAGIC or version != VERSION:
+        raise ValueError("%s: not a version %d Hexagon trace" %
+                         (path, VERSION))
+
+    chunks = []
+    for i in range(nchunks):
+        start = HEADER_SIZE + i * chunk_size
+        seq, used = struct.unpack_from(CHUNK_FMT, buf, start)
+        if seq != 0:
+            chunks.append((seq, start, used))
+
+    for _, start, used in sorted(chunks):
+        for packet in _parse_chunk(buf, start + struct.calcsize(CHUNK_FMT),
+                                   start + used):
+            yield packet
+
+
+def read_text(path):
+    """Yield the packets of a trace in text form, e.g. from a simulator."""
+    with open(path) as f:
+        for line in f:
+            if line.strip() and not line.startswith("#"):
+                yield Packet.parse(line)
+
+
+def write_reference(path, packets):
+    with open(path, "wb") as f:
+        f.write(struct.pack(REF_HEADER_FMT, REF_MAGIC, VERSION, 0))
+        for packet in packets:
+            f.write(packet.encode())
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Render a qemu-hexagon binary execution trace as text")
+    parser.add_argument("trace", help="ring file written by -hexagon-trace")
+    parser.add_argument("-n", "--count", type=int, default=0,
+                        help="only use the last COUNT packets")
+    parser.add_argument("--text", action="store_true",
+                        help="the input is a trace in text form")
+    parser.add_argument("--reference", metavar="FILE",
+                        help="write a reference trace for -hexagon-lockstep "
+                        "instead of printing")
+    args = parser.parse_args()
+
+    packets = read_text(args.trace) if args.text else read_trace(args.trace)
+    if args.count > 0:
+        packets = collections.deque(packets, args.count)
+    if args.reference:
+        write_reference(args.reference, packets)
+        return
+    try:
+        for packet in packets:
+            print(packet)
+    except BrokenPipeError:
+        pass
+
+
+if __name__ == "__main__":
+    sys.exit(main())
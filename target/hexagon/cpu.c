@@ -84,6 +84,7 @@ static void hexagon_cpu_initfn(Object *obj)
     CPUHexagonState *env = &cpu->env;
 
     cs->env_ptr = env;
+    hexagon_trace_cpu_reset(env);
 }
 
 static const VMStateDescription vmstate_hexagon_cpu = {
@@ -40,6 +40,14 @@
 #define EXCP_CPU_DUMP   1
 #define EXCP_HW_EXCP    2
 #define EXCP_TRAP_INSN  3
+#define EXCP_SYSCALL    4
+#define EXCP_SNAPSHOT   5
+
+/* Loads and stores recorded per packet by the execution trace */
+#define HEXAGON_TRACE_MEM_SLOTS 8
+
+/* Entries of the return address stack */
+#define HEXAGON_RAS_SIZE 16
 
 // General Purpose Registers Aliases
 #define GPR_SP 29
@@ -86,6 +94,11 @@ struct CPUHexagonState {
 
     uint32_t pc_written;
     uint32_t pc_trace;
+    /* Start of the last packet that trapped, where a syscall restarts */
+    uint32_t trap_pc;
+
+    /* Packets executed, counted when a TB completes */
+    uint64_t packet_count;
 
     uint32_t sa[2];
     uint32_t lc[2];
@@ -95,6 +108,23 @@ struct CPUHexagonState {
     /* Fields up to this point are cleared by a CPU reset */
     struct {} end_reset_fields;
 
+    /* Set by the first EXECSTATS call, packets are counted from then on */
+    bool count_packets;
+
+    /* Execution trace state, see exec-trace.c */
+    struct HexagonTraceRing *trace_ring;
+    void *trace_chunk;
+    uint32_t trace_off;
+    uint32_t trace_mem[HEXAGON_TRACE_MEM_SLOTS];
+
+    /* Return address stack, see ras.c */
+    struct HexagonRASSite *ras[HEXAGON_RAS_SIZE];
+    uint32_t ras_top;
+    unsigned ras_flush_count;
+    uint64_t ras_hits;
+    uint64_t ras_lookups;
+    uint64_t ras_misses;
+
     CPU_COMMON
 };
 
@@ -143,6 +173,24 @@ int hexagon_cpu_handle_mmu_fault(CPUState *cs,
                                   int mmu_idx);
 
 void hexagon_tcg_init(void);
+void hexagon_profile_init(const char *opts);
+void hexagon_profile_dump(void);
+void hexagon_trace_init(const char *opts);
+void hexagon_trace_cpu_reset(CPUHexagonState *env);
+void hexagon_trace_syscall(CPUHexagonState *env);
+void hexagon_lockstep_init(const char *path);
+void hexagon_snapshot_init(const char *opts);
+void hexagon_superblock_init(void);
+void hexagon_tier_init(const char *arg);
+void hexagon_warm_cache_init(const char *path);
+void hexagon_warm_cache_save(void);
+/*
+ * Save the guest memory, heap break and registers, replacing the previous
+ * snapshot, or rewind the guest to it.  A restore changes mappings, so it
+ * must be called outside of cpu_exec.  Both return 0 on success.
+ */
+int hexagon_snapshot_take(CPUHexagonState *env);
+int hexagon_snapshot_restore(CPUHexagonState *env);
 /* you can call this signal handler from your SIGBUS and SIGSEGV
    signal handlers to inform the virtual CPU of exceptions. non zero
    is returned if the signal was handled by the virtual CPU.  */
@@ -171,12 +219,41 @@ int cpu_hexagon_signal_handler(int host_signum, void *pinfo,
 
 target_ulong do_hexagon_semihosting(CPUHexagonState *env);
 
+/*
+ * State the translation blocks are specialized for, which rarely changes but
+ * would otherwise be tested by the generated code:
+ * - LPCFG_ZERO: no pipelined loop is running, so the endloops skip the
+ *   update of USR.LPCFG and P3;
+ * - LOOP0_START and LOOP1_START: the block starts a hardware loop body, and
+ *   can be chained to itself when it ends with the endloop;
+ * - COUNT_PACKETS: the guest asked for the packet count, which the blocks
+ *   then keep up to date.
+ */
+#define HEX_TB_FLAG_LPCFG_ZERO    (1 << 0)
+#define HEX_TB_FLAG_LOOP0_START   (1 << 1)
+#define HEX_TB_FLAG_LOOP1_START   (1 << 2)
+#define HEX_TB_FLAG_COUNT_PACKETS (1 << 3)
+
 static inline void cpu_get_tb_cpu_state(CPUHexagonState *env, target_ulong *pc,
                                         target_ulong *cs_base, uint32_t *flags)
 {
+    uint32_t f = 0;
+
     *pc = env->cr[CR_PC];
     *cs_base = 0;
-    *flags = 0;
+    if (env->lpcfg == 0) {
+        f |= HEX_TB_FLAG_LPCFG_ZERO;
+    }
+    if (*pc == env->sa[0]) {
+        f |= HEX_TB_FLAG_LOOP0_START;
+    }
+    if (*pc == env->sa[1]) {
+        f |= HEX_TB_FLAG_LOOP1_START;
+    }
+    if (env->count_packets) {
+        f |= HEX_TB_FLAG_COUNT_PACKETS;
+    }
+    *flags = f;
 }
 
 #endif
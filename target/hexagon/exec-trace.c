@@ -0,0 +1,275 @@
+/*
+ * Hexagon execution trace
+ *
+ * Copyright (c) 2017-2019 Comsecuris UG (haftungsbeschraenkt)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/error-report.h"
+#include "qemu/cutils.h"
+#include "qemu/host-utils.h"
+#include "cpu.h"
+#include "exec/exec-all.h"
+#include "exec/helper-proto.h"
+#include "exec/helper-gen.h"
+#include "tcg-op.h"
+#include "decoder.h"
+#include "exec-trace.h"
+
+#define HEXAGON_TRACE_DEFAULT_SIZE (64 * 1024 * 1024)
+
+typedef struct HexagonTraceRing {
+    uint8_t *base;
+    size_t size;
+    uint32_t nchunks;
+    uint32_t seq;
+} HexagonTraceRing;
+
+bool hexagon_trace_enabled;
+static char *trace_prefix;
+static uint64_t trace_size = HEXAGON_TRACE_DEFAULT_SIZE;
+
+void hexagon_trace_init(const char *opts)
+{
+    char **options = g_strsplit(opts, ",", -1);
+    char **opt;
+    const char *value;
+
+    for (opt = options; *opt != NULL; opt++) {
+        if (strstart(*opt, "size=", &value)) {
+            if (qemu_strtosz_MiB(value, NULL, &trace_size) < 0 ||
+                trace_size < 2 * HEXAGON_TRACE_CHUNK_SIZE) {
+                error_report("Invalid trace ring size: %s", value);
+                exit(EXIT_FAILURE);
+            }
+        } else if (opt == options) {
+            trace_prefix = g_strdup(*opt);
+        } else {
+            error_report("Invalid trace option: %s", *opt);
+            exit(EXIT_FAILURE);
+        }
+    }
+    g_strfreev(options);
+
+    if (trace_prefix == NULL) {
+        error_report("No trace file prefix given");
+        exit(EXIT_FAILURE);
+    }
+    hexagon_trace_enabled = true;
+}
+
+void hexagon_trace_cpu_reset(CPUHexagonState *env)
+{
+    /* The first packet executed opens a new ring, see helper_trace_chunk */
+    env->trace_ring = NULL;
+    env->trace_chunk = NULL;
+    env->trace_off = UINT32_MAX;
+}
+
+static HexagonTraceRing *trace_ring_open(void)
+{
+    HexagonTraceRing *ring = g_new0(HexagonTraceRing, 1);
+    HexagonTraceHeader *header;
+    char *name;
+    int fd;
+
+    ring->nchunks = trace_size / HEXAGON_TRACE_CHUNK_SIZE;
+    ring->size = HEXAGON_TRACE_HEADER_SIZE +
+                 (size_t)ring->nchunks * HEXAGON_TRACE_CHUNK_SIZE;
+
+    name = g_strdup_printf("%s.%d", trace_prefix, qemu_get_thread_id());
+    fd = open(name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, ring->size) < 0) {
+        error_report("Could not create trace file %s: %s", name,
+                     strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    ring->base = mmap(NULL, ring->size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                      fd, 0);
+    if (ring->base == MAP_FAILED) {
+        error_report("Could not map trace file %s: %s", name,
+                     strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    close(fd);
+    g_free(name);
+
+    header = (HexagonTraceHeader *)ring->base;
+    memcpy(header->magic, HEXAGON_TRACE_MAGIC, sizeof(header->magic));
+    header->version = HEXAGON_TRACE_VERSION;
+    header->chunk_size = HEXAGON_TRACE_CHUNK_SIZE;
+    header->nchunks = ring->nchunks;
+    header->tid = qemu_get_thread_id();
+
+    return ring;
+}
+
+/* Slow path of the trace: the current chunk is full, start the next one */
+void helper_trace_chunk(CPUHexagonState *env)
+{
+    HexagonTraceRing *ring = env->trace_ring;
+    HexagonTraceChunk *chunk;
+
+    if (ring == NULL) {
+        ring = trace_ring_open();
+        env->trace_ring = ring;
+    }
+
+    chunk = (HexagonTraceChunk *)(ring->base + HEXAGON_TRACE_HEADER_SIZE +
+                                  (size_t)(ring->seq % ring->nchunks) *
+                                  HEXAGON_TRACE_CHUNK_SIZE);
+    ring->seq++;
+
+    /* Invalidate the chunk before reusing it */
+    atomic_set(&chunk->used, sizeof(HexagonTraceChunk));
+    atomic_set(&chunk->seq, ring->seq);
+
+    env->trace_chunk = chunk;
+    env->trace_off = sizeof(HexagonTraceChunk);
+}
+
+/*
+ * A trap0 packet leaves the TB through cpu_loop_exit before its record is
+ * written; cpu_loop records it once the semihosting call or the Linux
+ * syscall has set r0.
+ */
+void hexagon_trace_syscall(CPUHexagonState *env)
+{
+    uint32_t rec[] = {
+        env->pc_trace, 1u << 0, 1u << CR_PC, 0, env->gpr[0], env->cr[CR_PC],
+    };
+
+    if (!hexagon_trace_enabled) {
+        return;
+    }
+    if (env->trace_off > HEXAGON_TRACE_CHUNK_SIZE - sizeof(rec)) {
+        helper_trace_chunk(env);
+    }
+    memcpy((uint8_t *)env->trace_chunk + env->trace_off, rec, sizeof(rec));
+    env->trace_off += sizeof(rec);
+    ((HexagonTraceChunk *)env->trace_chunk)->used = env->trace_off;
+}
+
+/*
+ * Make every load and store of the packet save its address to
+ * env->trace_mem, and return how many were found.  The address is saved
+ * before the access, as a load may overwrite its own address operand.
+ */
+static int trace_gen_mem(TCGOp *first_op)
+{
+    TCGOp *op;
+    int n = 0;
+
+    for (op = QTAILQ_NEXT(first_op, link); op != NULL;
+         op = QTAILQ_NEXT(op, link)) {
+        TCGOp *save;
+        TCGArg addr;
+
+        switch (op->opc) {
+        case INDEX_op_qemu_ld_i32:
+        case INDEX_op_qemu_st_i32:
+            addr = op->args[1];
+            break;
+        case INDEX_op_qemu_ld_i64:
+        case INDEX_op_qemu_st_i64:
+            addr = op->args[TCG_TARGET_REG_BITS == 32 ? 2 : 1];
+            break;
+        default:
+            continue;
+        }
+        if (n == HEXAGON_TRACE_MEM_SLOTS) {
+            break;
+        }
+
+        save = tcg_op_insert_before(tcg_ctx, op, INDEX_op_st_i32, 3);
+        save->args[0] = addr;
+        save->args[1] = tcgv_ptr_arg(cpu_env);
+        save->args[2] = offsetof(CPUHexagonState, trace_mem[n]);
+        n++;
+    }
+    return n;
+}
+
+void hexagon_trace_gen_packet(TCGOp *first_op, uint32_t pc, uint64_t written)
+{
+    uint32_t gpr_mask = written;
+    uint32_t cr_mask = written >> 32;
+    uint32_t header[4];
+    TCGLabel *has_room = gen_new_label();
+    TCGv_ptr chunk, rec;
+    TCGv_i32 off, tmp;
+    int nmem, size, i, pos;
+
+    nmem = trace_gen_mem(first_op);
+    size = sizeof(header) + 4 * (ctpop32(gpr_mask) + ctpop32(cr_mask) + nmem);
+
+    off = tcg_temp_new_i32();
+    tcg_gen_ld_i32(off, cpu_env, offsetof(CPUHexagonState, trace_off));
+    tcg_gen_brcondi_i32(TCG_COND_LEU, off, HEXAGON_TRACE_CHUNK_SIZE - size,
+                        has_room);
+    gen_helper_trace_chunk(cpu_env);
+    gen_set_label(has_room);
+
+    chunk = tcg_temp_new_ptr();
+    rec = tcg_temp_new_ptr();
+    tmp = tcg_temp_new_i32();
+    tcg_gen_ld_i32(off, cpu_env, offsetof(CPUHexagonState, trace_off));
+    tcg_gen_ld_ptr(chunk, cpu_env, offsetof(CPUHexagonState, trace_chunk));
+    tcg_gen_ext_i32_ptr(rec, off);
+    tcg_gen_add_ptr(rec, rec, chunk);
+
+    header[0] = pc;
+    header[1] = gpr_mask;
+    header[2] = cr_mask;
+    header[3] = nmem;
+    for (pos = 0; pos < ARRAY_SIZE(header); pos++) {
+        tcg_gen_movi_i32(tmp, header[pos]);
+        tcg_gen_st_i32(tmp, rec, 4 * pos);
+    }
+    for (i = 0; i < 32; i++) {
+        if (gpr_mask & (1u << i)) {
+            tcg_gen_st_i32(GPR[i], rec, 4 * pos++);
+        }
+    }
+    for (i = 0; i < 32; i++) {
+        if (cr_mask & (1u << i)) {
+            tcg_gen_st_i32(CR[i], rec, 4 * pos++);
+        }
+    }
+    for (i = 0; i < nmem; i++) {
+        tcg_gen_ld_i32(tmp, cpu_env, offsetof(CPUHexagonState, trace_mem[i]));
+        tcg_gen_st_i32(tmp, rec, 4 * pos++);
+        /* Accesses skipped by a false predicate are reported as 0 */
+        tcg_gen_movi_i32(tmp, 0);
+        tcg_gen_st_i32(tmp, cpu_env, offsetof(CPUHexagonState, trace_mem[i]));
+    }
+
+    tcg_gen_addi_i32(off, off, size);
+    tcg_gen_st_i32(off, cpu_env, offsetof(CPUHexagonState, trace_off));
+    tcg_gen_st_i32(off, chunk, offsetof(HexagonTraceChunk, used));
+
+    tcg_temp_free_i32(tmp);
+    tcg_temp_free_ptr(rec);
+    tcg_temp_free_ptr(chunk);
+    tcg_temp_free_i32(off);
+}
@@ -0,0 +1,96 @@
+/*
+ * Hexagon execution trace
+ *
+ * Copyright (c) 2017-2019 Comsecuris UG (haftungsbeschraenkt)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HEXAGON_EXEC_TRACE_H
+#define HEXAGON_EXEC_TRACE_H
+
+/*
+ * Binary execution trace.
+ *
+ * Each vCPU appends one record per executed packet to its own ring file,
+ * <prefix>.<tid>, mapped shared into QEMU:
+ *
+ *   HexagonTraceHeader                          (HEXAGON_TRACE_HEADER_SIZE)
+ *   chunk 0 .. nchunks - 1                      (chunk_size bytes each)
+ *
+ * A chunk starts with a HexagonTraceChunk header and is filled with whole
+ * records; "used" is updated after every record, so the file is
+ * consistent even if QEMU dies.  Chunks are reused round-robin and
+ * "seq" gives their order.  A record is a sequence of 32-bit host-endian
+ * words:
+ *
+ *   pc, gpr_mask, cr_mask, nmem,
+ *   one value per bit set in gpr_mask, then in cr_mask (after the packet),
+ *   nmem addresses of the loads and stores of the packet (0 if not taken)
+ *
+ * scripts/hexagon-trace.py renders a ring file as text, and converts it
+ * to a reference trace for -hexagon-lockstep: a HexagonTraceRefHeader
+ * followed by the records, oldest first.
+ */
+
+#define HEXAGON_TRACE_MAGIC       "HEXTRACE"
+#define HEXAGON_TRACE_REF_MAGIC   "HEXTREF\0"
+#define HEXAGON_TRACE_VERSION     1
+#define HEXAGON_TRACE_HEADER_SIZE 4096
+#define HEXAGON_TRACE_CHUNK_SIZE  (64 * 1024)
+
+typedef struct HexagonTraceHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t chunk_size;
+    uint32_t nchunks;
+    uint32_t tid;
+} HexagonTraceHeader;
+
+typedef struct HexagonTraceChunk {
+    uint32_t seq;
+    uint32_t used;
+} HexagonTraceChunk;
+
+typedef struct HexagonTraceRefHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+} HexagonTraceRefHeader;
+
+extern bool hexagon_trace_enabled;
+
+/*
+ * Emit the trace record of the packet whose ops follow @first_op.  Called
+ * at the end of the packet, once the registers in @written are committed.
+ */
+void hexagon_trace_gen_packet(TCGOp *first_op, uint32_t pc, uint64_t written);
+
+extern bool hexagon_lockstep_enabled;
+
+/*
+ * Emit the lockstep check of the previous TB at the start of a TB; the
+ * packet list of the TB being translated is attached at its end.
+ */
+void hexagon_lockstep_gen_tb_start(void);
+void hexagon_lockstep_gen_tb_end(const uint32_t *packets, int npackets);
+
+#endif
@@ -31,21 +31,43 @@
 #include <stdlib.h>
 #include <limits.h>
 #include <float.h>
+#include <pthread.h>
+#include <unistd.h>
 
 typedef struct {
   uint32_t Value;
   uint32_t Mask;
 } Instruction;
 
-void printTimes(char *String, unsigned Times) {
+// Result of findBest for a set of instructions, see the memo below
+typedef struct MemoEntry {
+  struct MemoEntry *Next;
+  uint32_t Hash;
+  uint32_t Mask;
+  unsigned Bits;
+  unsigned Count;
+  Instruction *Subset;
+  unsigned BestBits;
+  float Score;
+  uint8_t BestChoice[32];
+} MemoEntry;
+
+#define MEMO_BUCKETS 4096
+
+// Sibling nodes often select the very same instructions; score them once
+static MemoEntry *Memo[MEMO_BUCKETS];
+static pthread_mutex_t MemoLock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned Threads = 1;
+
+void printTimes(FILE *Out, char *String, unsigned Times) {
   while (Times --> 0)
-    printf("%s", String);
+    fprintf(Out, "%s", String);
 }
 
-void printBinaryBits(uint32_t Value, unsigned Bits) {
+void printBinaryBits(FILE *Out, uint32_t Value, unsigned Bits) {
   unsigned I = Bits;
   while (I --> 0)
-    printf("%c", Value & (1 << I) ? '1' : '0');
+    fprintf(Out, "%c", Value & (1 << I) ? '1' : '0');
 }
 
 void printBinary(uint32_t Value) {
@@ -98,6 +120,62 @@ void quickTest(void) {
   assert(extractBits(0b010101, Choice2, 3) == 0);
 }
 
+static uint32_t hashSubset(Instruction *Subset, unsigned Count,
+                           uint32_t Mask, unsigned Bits) {
+  uint32_t Hash = 2166136261U ^ Mask ^ (Bits << 24);
+  for (unsigned I = 0; I < Count; I++) {
+    Hash = (Hash ^ Subset[I].Value) * 16777619U;
+    Hash = (Hash ^ Subset[I].Mask) * 16777619U;
+  }
+  return Hash;
+}
+
+static MemoEntry *lookupMemo(uint32_t Hash, Instruction *Subset,
+                             unsigned Count, uint32_t Mask, unsigned Bits) {
+  MemoEntry *Entry;
+  pthread_mutex_lock(&MemoLock);
+  for (Entry = Memo[Hash % MEMO_BUCKETS]; Entry != NULL; Entry = Entry->Next)
+    if (Entry->Hash == Hash && Entry->Mask == Mask && Entry->Bits == Bits &&
+        Entry->Count == Count &&
+        memcmp(Entry->Subset, Subset, Count * sizeof(Instruction)) == 0)
+      break;
+  pthread_mutex_unlock(&MemoLock);
+  return Entry;
+}
+
+static void insertMemo(uint32_t Hash, Instruction *Subset, unsigned Count,
+                       uint32_t Mask, unsigned Bits, unsigned BestBits,
+                       float Score, uint8_t *BestChoice) {
+  MemoEntry *Entry = calloc(1, sizeof(MemoEntry));
+  assert(Entry != NULL);
+  Entry->Hash = Hash;
+  Entry->Mask = Mask;
+  Entry->Bits = Bits;
+  Entry->Count = Count;
+  Entry->Subset = malloc(Count * sizeof(Instruction) + 1);
+  assert(Entry->Subset != NULL);
+  memcpy(Entry->Subset, Subset, Count * sizeof(Instruction));
+  Entry->BestBits = BestBits;
+  Entry->Score = Score;
+  memcpy(Entry->BestChoice, BestChoice, sizeof(Entry->BestChoice));
+
+  pthread_mutex_lock(&MemoLock);
+  Entry->Next = Memo[Hash % MEMO_BUCKETS];
+  Memo[Hash % MEMO_BUCKETS] = Entry;
+  pthread_mutex_unlock(&MemoLock);
+}
+
+static void freeMemo(void) {
+  for (unsigned I = 0; I < MEMO_BUCKETS; I++) {
+    while (Memo[I] != NULL) {
+      MemoEntry *Entry = Memo[I];
+      Memo[I] = Entry->Next;
+      free(Entry->Subset);
+      free(Entry);
+    }
+  }
+}
+
 unsigned findBest(Instruction *Instructions,
                   Instruction *TargetInstructions,
                   Instruction *SelectedInstructions,
@@ -119,6 +197,17 @@ unsigned findBest(Instruction *Instructions,
   }
   *Count = TargetInstructionsCount;
 
+  uint32_t Hash = hashSubset(TargetInstructions, TargetInstructionsCount,
+                             MaskedValue->Mask, Bits);
+  MemoEntry *Entry = lookupMemo(Hash, TargetInstructions,
+                                TargetInstructionsCount, MaskedValue->Mask,
+                                Bits);
+  if (Entry != NULL) {
+    memcpy(BestChoice, Entry->BestChoice, sizeof(Entry->BestChoice));
+    *Score = Entry->Score;
+    return Entry->BestBits;
+  }
+
   // 2. Compute the choosable bits
   uint8_t Choosable[32] = { 0 };
   unsigned ChoosableCount = 0;
@@ -131,44 +220,68 @@ unsigned findBest(Instruction *Instructions,
   for (unsigned J = 0; J < Bits; J++)
     Choice[J] = J;
 
+  // Report the first combination if nothing matches at all
+  memset(BestChoice, 0, 32);
+  for (unsigned J = 0; J < Bits && J < ChoosableCount; J++)
+    BestChoice[J] = Choosable[J];
+
   int K = 1;
   while (K >= 0) {
 
     // Get the corresponding choosable indexes
     uint8_t RealChoice[32];
-    for (unsigned J = 0; J < Bits; J++)
+    uint32_t ChoiceMask = 0;
+    for (unsigned J = 0; J < Bits; J++) {
       RealChoice[J] = Choosable[Choice[J]];
-
-    // Keep only the interesting bits
-    for (unsigned L = 0; L < TargetInstructionsCount; L++) {
-      SelectedInstructions[L].Value = extractBits(TargetInstructions[L].Value,
-                                                  RealChoice,
-                                                  Bits);
-      SelectedInstructions[L].Mask = extractBits(TargetInstructions[L].Mask,
-                                                 RealChoice,
-                                                 Bits);
+      ChoiceMask |= 1 << RealChoice[J];
     }
 
+    // Each instruction matches one value of the chosen bits per don't care
+    // bit among them, so the total does not depend on the enumeration
+    // below.  With all 2^Bits values matched the score would be lowest;
+    // skip the combination if even that cannot beat the best one.
     unsigned TotalMatches = 0;
+    for (unsigned L = 0; L < TargetInstructionsCount; L++)
+      TotalMatches += 1U << (Bits - __builtin_popcount(TargetInstructions[L].Mask
+                                                      & ChoiceMask));
     unsigned Options = (1 << Bits);
-    for (unsigned L = 0; L < (1U << Bits); L++) {
-      bool NoMatch = true;
-      for (unsigned M = 0; M < TargetInstructionsCount; M++) {
-        uint32_t MaskedL = L & SelectedInstructions[M].Mask;
-        uint32_t Value = SelectedInstructions[M].Value;
-        if (MaskedL == Value) {
-          TotalMatches++;
-          NoMatch = false;
-        }
+    bool Pruned = (float) TotalMatches / Options >= BestScore;
+
+    if (!Pruned) {
+      // Keep only the interesting bits
+      for (unsigned L = 0; L < TargetInstructionsCount; L++) {
+        SelectedInstructions[L].Value = extractBits(TargetInstructions[L].Value,
+                                                    RealChoice,
+                                                    Bits);
+        SelectedInstructions[L].Mask = extractBits(TargetInstructions[L].Mask,
+                                                   RealChoice,
+                                                   Bits);
       }
 
-      if (NoMatch)
-        Options--;
+      // Count the values matched by at least one instruction, giving up as
+      // soon as the unmatched ones make it impossible to improve
+      for (unsigned L = 0; L < (1U << Bits); L++) {
+        bool NoMatch = true;
+        for (unsigned M = 0; M < TargetInstructionsCount; M++) {
+          uint32_t MaskedL = L & SelectedInstructions[M].Mask;
+          if (MaskedL == SelectedInstructions[M].Value) {
+            NoMatch = false;
+            break;
+          }
+        }
+
+        if (NoMatch) {
+          Options--;
+          if (Options == 0 || (float) TotalMatches / Options >= BestScore) {
+            Pruned = true;
+            break;
+          }
+        }
+      }
     }
 
-    float NewScore = (float) TotalMatches / Options;
-    if (Options > 0 && NewScore < BestScore) {
-      BestScore = NewScore;
+    if (!Pruned) {
+      BestScore = (float) TotalMatches / Options;
       BestBits = Bits;
       memcpy(BestChoice, RealChoice, sizeof(Choice));
     }
@@ -188,11 +301,144 @@ unsigned findBest(Instruction *Instructions,
 
   }
 
+  insertMemo(Hash, TargetInstructions, TargetInstructionsCount,
+             MaskedValue->Mask, Bits, BestBits, BestScore, BestChoice);
   *Score = BestScore;
   return BestBits;
 }
 
-void go(Instruction *Instructions,
+void go(FILE *Out,
+        FILE *Log,
+        Instruction *Instructions,
+        Instruction *TargetInstructions,
+        Instruction *SelectedInstructions,
+        unsigned InstructionCount,
+        Instruction *Tmp,
+        uint8_t Choices[32][32],
+        unsigned Depth,
+        uint8_t *BitsPerMemoryAccess,
+        unsigned MaxDepth);
+
+// A subtree below the root, rendered by one of the worker threads
+typedef struct {
+  Instruction Tmp;
+  uint8_t Choices[32][32];
+  char *Out;
+  size_t OutSize;
+  char *Log;
+  size_t LogSize;
+} Subtree;
+
+typedef struct {
+  Subtree *Subtrees;
+  unsigned SubtreeCount;
+  unsigned Next;
+  Instruction *Instructions;
+  unsigned InstructionCount;
+  uint8_t *BitsPerMemoryAccess;
+  unsigned MaxDepth;
+} SubtreeQueue;
+
+static void *subtreeWorker(void *Opaque) {
+  SubtreeQueue *Queue = Opaque;
+  Instruction *TargetInstructions = calloc(Queue->InstructionCount + 1,
+                                           sizeof(Instruction));
+  Instruction *SelectedInstructions = calloc(Queue->InstructionCount + 1,
+                                             sizeof(Instruction));
+  assert(TargetInstructions != NULL && SelectedInstructions != NULL);
+
+  while (true) {
+    unsigned I = __atomic_fetch_add(&Queue->Next, 1, __ATOMIC_RELAXED);
+    if (I >= Queue->SubtreeCount)
+      break;
+
+    Subtree *Task = &Queue->Subtrees[I];
+    FILE *Out = open_memstream(&Task->Out, &Task->OutSize);
+    FILE *Log = open_memstream(&Task->Log, &Task->LogSize);
+    assert(Out != NULL && Log != NULL);
+    go(Out,
+       Log,
+       Queue->Instructions,
+       TargetInstructions,
+       SelectedInstructions,
+       Queue->InstructionCount,
+       &Task->Tmp,
+       Task->Choices,
+       1,
+       Queue->BitsPerMemoryAccess,
+       Queue->MaxDepth);
+    fclose(Out);
+    fclose(Log);
+  }
+
+  free(TargetInstructions);
+  free(SelectedInstructions);
+  return NULL;
+}
+
+// Render the children of the root in parallel, then print them in order
+static void goParallel(FILE *Out,
+                       FILE *Log,
+                       Instruction *Instructions,
+                       unsigned InstructionCount,
+                       Instruction *Tmp2,
+                       uint8_t Choices[32][32],
+                       unsigned BestBits,
+                       uint8_t *BitsPerMemoryAccess,
+                       unsigned MaxDepth) {
+  SubtreeQueue Queue = { 0 };
+  Queue.SubtreeCount = 1U << BestBits;
+  Queue.Subtrees = calloc(Queue.SubtreeCount, sizeof(Subtree));
+  assert(Queue.Subtrees != NULL);
+  Queue.Instructions = Instructions;
+  Queue.InstructionCount = InstructionCount;
+  Queue.BitsPerMemoryAccess = BitsPerMemoryAccess;
+  Queue.MaxDepth = MaxDepth;
+
+  for (unsigned L = 0; L < Queue.SubtreeCount; L++) {
+    Subtree *Task = &Queue.Subtrees[L];
+    Task->Tmp = *Tmp2;
+    for (unsigned M = 0; M < BestBits; M++)
+      if (L & (1 << M))
+        Task->Tmp.Value |= 1 << Choices[0][M];
+    memcpy(Task->Choices, Choices, sizeof(Task->Choices));
+  }
+
+  unsigned ThreadCount = Threads < Queue.SubtreeCount ? Threads
+                                                      : Queue.SubtreeCount;
+  pthread_t *Workers = calloc(ThreadCount, sizeof(pthread_t));
+  assert(Workers != NULL);
+  for (unsigned I = 0; I < ThreadCount; I++)
+    if (pthread_create(&Workers[I], NULL, subtreeWorker, &Queue) != 0) {
+      fprintf(stderr, "Couldn't create worker thread\n");
+      exit(EXIT_FAILURE);
+    }
+  for (unsigned I = 0; I < ThreadCount; I++)
+    pthread_join(Workers[I], NULL);
+  free(Workers);
+
+  for (unsigned L = 0; L < Queue.SubtreeCount; L++) {
+    Subtree *Task = &Queue.Subtrees[L];
+    printTimes(Out, "  ", 3);
+    fprintf(Out, "\"");
+    printBinaryBits(Out, L, BestBits);
+    fprintf(Out, "\": {\n");
+    fwrite(Task->Out, 1, Task->OutSize, Out);
+    fwrite(Task->Log, 1, Task->LogSize, Log);
+    printTimes(Out, "  ", 3);
+    fprintf(Out, "}");
+    if (L != Queue.SubtreeCount - 1)
+      fprintf(Out, ",");
+    fprintf(Out, "\n");
+    free(Task->Out);
+    free(Task->Log);
+  }
+  free(Queue.Subtrees);
+}
+
+void go(FILE *Out,
+        FILE *Log,
+        Instruction *Instructions,
         Instruction *TargetInstructions,
         Instruction *SelectedInstructions,
         unsigned InstructionCount,
@@ -214,58 +460,75 @@ void go(Instruction *Instructions,
                       &Count,
                       BitsPerMemoryAccess[Depth]);
 
-  printTimes("  ", 2 + Depth * 2);
-  printf("\"bits\": [%d", Choices[Depth][0]);
+  printTimes(Out, "  ", 2 + Depth * 2);
+  fprintf(Out, "\"bits\": [%d", Choices[Depth][0]);
   for (unsigned I = 1; I < BitsPerMemoryAccess[Depth]; I++)
-    printf(", %d", Choices[Depth][I]);
-  printf("]");
-  printf(",\n");
-  printTimes("  ", 2 + Depth * 2);
-
-  if (Depth < MaxDepth - 1) {
-    printf("\"options\": {\n");
+    fprintf(Out, ", %d", Choices[Depth][I]);
+  fprintf(Out, "]");
+  fprintf(Out, ",\n");
+  printTimes(Out, "  ", 2 + Depth * 2);
+
+  if (Count == 0) {
+    // No instruction has this encoding, there is nothing left to decode
+    fprintf(Out, "\"instructions\": {\n");
+  } else if (Depth < MaxDepth - 1) {
+    fprintf(Out, "\"options\": {\n");
     Instruction Tmp2 = *Tmp;
     for (unsigned M = 0; M < BestBits; M++)
       Tmp2.Mask |= 1 << Choices[Depth][M];
 
-    for (unsigned L = 0; L < (1U << BestBits); L++) {
-      printTimes("  ", 2 + Depth * 2 + 1);
-      printf("\"");
-      printBinaryBits(L, BestBits);
-      printf("\": {\n");
-
-      Tmp2.Value = Tmp->Value;
-      for (unsigned M = 0; M < BestBits; M++)
-        if (L & (1 << M))
-          Tmp2.Value |= 1 << Choices[Depth][M];
-      go(Instructions,
-         TargetInstructions,
-         SelectedInstructions,
-         InstructionCount,
-         &Tmp2,
-         Choices,
-         Depth + 1,
-         BitsPerMemoryAccess,
-         MaxDepth);
-
-      printTimes("  ", 2 + Depth * 2 + 1);
-      printf("}");
-      if (L != (1U << BestBits) - 1)
-        printf(",");
-      printf("\n");
+    if (Depth == 0 && Threads > 1) {
+      goParallel(Out,
+                 Log,
+                 Instructions,
+                 InstructionCount,
+                 &Tmp2,
+                 Choices,
+                 BestBits,
+                 BitsPerMemoryAccess,
+                 MaxDepth);
+    } else {
+      for (unsigned L = 0; L < (1U << BestBits); L++) {
+        printTimes(Out, "  ", 2 + Depth * 2 + 1);
+        fprintf(Out, "\"");
+        printBinaryBits(Out, L, BestBits);
+        fprintf(Out, "\": {\n");
+
+        Tmp2.Value = Tmp->Value;
+        for (unsigned M = 0; M < BestBits; M++)
+          if (L & (1 << M))
+            Tmp2.Value |= 1 << Choices[Depth][M];
+        go(Out,
+           Log,
+           Instructions,
+           TargetInstructions,
+           SelectedInstructions,
+           InstructionCount,
+           &Tmp2,
+           Choices,
+           Depth + 1,
+           BitsPerMemoryAccess,
+           MaxDepth);
+
+        printTimes(Out, "  ", 2 + Depth * 2 + 1);
+        fprintf(Out, "}");
+        if (L != (1U << BestBits) - 1)
+          fprintf(Out, ",");
+        fprintf(Out, "\n");
+      }
     }
 
   } else {
-    printf("\"instructions\": {\n");
+    fprintf(Out, "\"instructions\": {\n");
     Instruction Tmp2 = *Tmp;
     for (unsigned M = 0; M < BestBits; M++)
       Tmp2.Mask |= 1 << Choices[Depth][M];
 
     for (unsigned L = 0; L < (1U << BestBits); L++) {
-      printTimes("  ", 2 + Depth * 2 + 1);
-      printf("\"");
-      printBinaryBits(L, BestBits);
-      printf("\": [");
+      printTimes(Out, "  ", 2 + Depth * 2 + 1);
+      fprintf(Out, "\"");
+      printBinaryBits(Out, L, BestBits);
+      fprintf(Out, "\": [");
 
       Tmp2.Value = Tmp->Value;
       for (unsigned M = 0; M < BestBits; M++)
@@ -277,17 +540,17 @@ void go(Instruction *Instructions,
         uint32_t Mask = Instructions[M].Mask & Tmp2.Mask;
         if ((Tmp2.Value & Mask) == (Instructions[M].Value & Mask)) {
           if (!IsFirst) {
-            printf(", ");
+            fprintf(Out, ", ");
           }
           IsFirst = false;
-          printf("%d", M);
+          fprintf(Out, "%d", M);
         }
       }
 
-      printf("]");
+      fprintf(Out, "]");
       if (L != (1U << BestBits) - 1)
-        printf(",");
-      printf("\n");
+        fprintf(Out, ",");
+      fprintf(Out, "\n");
     }
 
     // Print to stderr coloful stuff
@@ -301,20 +564,37 @@ void go(Instruction *Instructions,
         }
       }
 
-      printWithColors(stderr, Tmp->Value, Colors);
-      fprintf(stderr, " %2.2f/%d\n", Score, Count);
+      printWithColors(Log, Tmp->Value, Colors);
+      fprintf(Log, " %2.2f/%d\n", Score, Count);
     }
 
   }
-  printTimes("  ", 2 + Depth * 2);
-  printf("}");
-  printf("\n");
+  printTimes(Out, "  ", 2 + Depth * 2);
+  fprintf(Out, "}");
+  fprintf(Out, "\n");
 }
 
 int main(int argc, char *argv[]) {
 
+  long Online = sysconf(_SC_NPROCESSORS_ONLN);
+  Threads = Online > 0 ? Online : 1;
+
+  int Opt;
+  while ((Opt = getopt(argc, argv, "j:")) != -1) {
+    switch (Opt) {
+    case 'j':
+      Threads = atoi(optarg) > 0 ? atoi(optarg) : 1;
+      break;
+    default:
+      argc = 0;
+      break;
+    }
+  }
+  argv += optind - 1;
+  argc -= optind - 1;
+
   if (argc < 3) {
-    fprintf(stderr, "Usage: %s INSTRUCTIONS_CSV"
+    fprintf(stderr, "Usage: %s [-j THREADS] INSTRUCTIONS_CSV"
             " BITS_PER_ACCESS1 BITS_PER_ACCESS2...\n", argv[0]);
     return EXIT_FAILURE;
   }
@@ -438,7 +718,9 @@ int main(int argc, char *argv[]) {
   uint8_t Choices[32][32];
   bzero(&Choices, sizeof(Choices));
   Instruction Fixed = { 0, 0 };
-  go(Buffer,
+  go(stdout,
+     stderr,
+     Buffer,
      TargetInstructions,
      SelectedInstructions,
      InstructionCount,
@@ -450,7 +732,10 @@ int main(int argc, char *argv[]) {
   printf("  }\n");
   printf("}\n");
 
+  free(TargetInstructions);
+  free(SelectedInstructions);
   free(Buffer);
+  freeMemo();
 
   return EXIT_SUCCESS;
 }
@@ -30,10 +30,15 @@ from collections import defaultdict
 from pprint import pprint
 
 import argparse
+import concurrent.futures
 import csv
 import json
+import os
+import queue
 import re
 import subprocess
+import sys
+import time
 
 instruction_strings = []
 sub_instruction_strings = []
@@ -43,6 +48,10 @@ specialization_params = {}
 endloops = {}
 patterns = []
 meta_mapping = defaultdict(list)
+# Meta-instruction implementing each instruction, and each sub-instruction
+inst_meta = {}
+sub_inst_meta = {}
+function_bodies = []
 implemented_meta = 0
 implemented_insn = 0
 system_insn = 0
@@ -63,8 +72,8 @@ DECODER_HEADER = """#ifndef HEXAGON_DECODER_H
 #include "tcg.h"
 
 #define LOG_DIS(...) qemu_log_mask(CPU_LOG_TB_IN_ASM, ## __VA_ARGS__)
-#define SET_USED_REG(reg_struct, reg) {\\
-        if (is_conditional) \\
+#define SET_USED_REG(dc, reg_struct, reg) {\\
+        if ((dc)->cond_depth > 0) \\
             reg_struct.conditional |= (uint64_t)1 << (reg); \\
         else \\
             reg_struct.written |= (uint64_t)1 << (reg); \\
@@ -98,8 +107,8 @@ DECODER_HEADER = """#ifndef HEXAGON_DECODER_H
 #define SET_READ_PRE(dc, pre_index) dc->deps[dc->i].read |= (uint8_t)1 << (pre_index)
 #define GET_USED_REG(reg_struct, reg) (reg_struct).written & (uint64_t)1 << (reg)
 #define GET_COND_REG(reg_struct, reg) (reg_struct).conditional & (uint64_t)1 << (reg)
-#define SET_BEGIN_COND() is_conditional = true;
-#define SET_END_COND() is_conditional = false;
+#define SET_BEGIN_COND(dc) ((dc)->cond_depth++)
+#define SET_END_COND(dc) ((dc)->cond_depth--)
 #define SET_JUMP_FLAG(dc) { \\
     switch (dc->jump_count) { \\
         case 0: SET_WRITTEN_PRE(dc, 4); break; \\
@@ -108,6 +117,12 @@ DECODER_HEADER = """#ifndef HEXAGON_DECODER_H
     } \\
     dc->jump_count++; \\
 }
+#define SET_CALL(dc) ((dc)->is_call = true)
+#define SET_RETURN(dc) ((dc)->is_return = true)
+#define SET_BRANCH_TARGET(dc, pc) \\
+    ((dc)->branch_target = (pc), (dc)->branch_count++)
+#define SET_BRANCH_HINT(dc, taken) ((dc)->branch_hint = (taken))
+#define SET_LPCFG_WRITTEN(dc) ((dc)->lpcfg_written = true)
 #define ADD_IF_ZERO(x, y) {\\
         assert((x == 0 || y == 0) && "Overlapping instruction encodings!");\\
         x += y;\\
@@ -180,6 +195,22 @@ typedef struct DisasContext {
     bool is_pre_written;
     TCGOp *packet_first_op;
     int jump_count;
+    /* The packet ending the block is a call or a return, see ras.c */
+    bool is_call;
+    bool is_return;
+    /* Direct branches of the packet, followed by superblock.c */
+    int branch_count;
+    uint32_t branch_target;
+    bool branch_hint;
+    /* USR.LPCFG was set in the block, see HEX_TB_FLAG_LPCFG_ZERO */
+    bool lpcfg_written;
+    /* The packet ending the block closes a hardware loop */
+    bool is_endloop;
+    /* Nesting of the semantics' if statements, whose writes are conditional */
+    int cond_depth;
+    /* The packet traps, see handle_packet_end */
+    bool trap;
+    uint32_t trap_index;
     regs_t regs;
     deps_t deps[4];
     deps_t * original[4];
@@ -208,6 +239,8 @@ regs_t sub_execute(unsigned inst_id, DisasContext *dc);
 void endloop0(void);
 void endloop01(void);
 void endloop1(void);
+void endloop0_lpcfg_zero(void);
+void endloop01_lpcfg_zero(void);
 
 """
 DECODER_INCLUDES = """#include "qemu/osdep.h"
@@ -220,9 +253,10 @@ static const int pred_whitening[4] = { 0xffffff00,
                                        0xff00ffff,
                                        0x00ffffff };
 
-bool is_conditional = false;
+"""
 
-int get_destination_reg(regs_t regs, int t) {
+# Only in decoder.c, not in the shards holding the semantic functions
+DECODER_HELPERS = """int get_destination_reg(regs_t regs, int t) {
     d_reg_list reg_list = regs.destination;
     if (reg_list == NULL)
         assert(false && "Invalid .new instruction reference!");
@@ -249,6 +283,7 @@ void push_destination_reg(d_reg_list* list, int index) {
 def gen_macros():
     code = ""
     code += DECODER_INCLUDES
+    code += DECODER_HELPERS
     with open(decoder_c, "w") as d:
         d.write(code)
 
@@ -558,7 +593,7 @@ def gen_execute():
                  ", {}" * len(format_identifiers) +
                  ");\n").format(to_format_string(inst_str), *format_identifiers)
         # Call the correct semantics function
-        code += gen_function_call(inst_str, identifiers)
+        code += gen_function_call(inst_str, identifiers, inst_id, inst_meta)
         code += "break;\n}\n"
 
     code += 'default: assert(false && '\
@@ -582,13 +617,72 @@ def get_params(pattern):
     return params
 
 
-# Invoke semantics compiler to fill function body
-def gen_function_body(pattern_index):
-    global implemented_meta
-    global implemented_insn
-    global implemented_vect
-    qemu_code = ""
-    qemu_code += "regs_t regs = { 0 };\n"
+class SemanticsWorker(object):
+    """A semantics compiler running in batch mode (-B)."""
+
+    def __init__(self):
+        self.start()
+
+    def start(self):
+        # Diagnostics would be mixed with the answers on stdout
+        self.proc = subprocess.Popen([semantics_path, "-B"],
+                                     stdout=subprocess.PIPE,
+                                     stdin=subprocess.PIPE,
+                                     stderr=subprocess.DEVNULL)
+
+    def compile(self, flags, code):
+        code = code.encode("utf-8")
+        header = "{} {}\n".format("".join(flags) or "-", len(code))
+        try:
+            self.proc.stdin.write(header.encode("utf-8") + code)
+            self.proc.stdin.flush()
+            answer = self.proc.stdout.readline()
+        except BrokenPipeError:
+            answer = b""
+        if not answer:
+            # The parser gave up with assert() or abort(): the request
+            # fails like in a single-shot run, and a new worker takes over
+            try:
+                self.proc.stdin.close()
+            except BrokenPipeError:
+                pass
+            status = self.proc.wait()
+            self.start()
+            return 128 - status if status < 0 else status, ""
+        status, length = answer.split()
+        output = self.proc.stdout.read(int(length)).decode("utf-8")
+        return int(status), output
+
+    def close(self):
+        self.proc.stdin.close()
+        self.proc.wait()
+
+
+# Run the semantics compiler on a list of (flags, code) requests, spread
+# over a pool of batch mode workers; returns (exit code, output) pairs
+def run_semantics(requests):
+    workers = queue.Queue()
+    all_workers = []
+
+    def compile_one(request):
+        try:
+            worker = workers.get_nowait()
+        except queue.Empty:
+            worker = SemanticsWorker()
+            all_workers.append(worker)
+        result = worker.compile(*request)
+        workers.put(worker)
+        return result
+
+    with concurrent.futures.ThreadPoolExecutor(jobs) as pool:
+        results = list(pool.map(compile_one, requests))
+    for worker in all_workers:
+        worker.close()
+    return results
+
+
+# Semantics compiler options and code for a meta-instruction
+def semantics_request(pattern_index):
     instruction_code = meta_instructions[pattern_index]["code"]
     # Patch missing semicolons
     instruction_code = instruction_code.replace(" if", "; if")
@@ -599,39 +693,69 @@ def gen_function_body(pattern_index):
     if len(mem_size) == 1:
         mem_size = mem_size[0]
         if "u" in mem_size:
-            mem_args.append("-u")
+            mem_args.append("u")
         if "b" in mem_size:
-            mem_args.append("-b")
+            mem_args.append("b")
         elif "h" in mem_size:
-            mem_args.append("-h")
+            mem_args.append("h")
         elif "w" in mem_size:
-            mem_args.append("-w")
+            mem_args.append("w")
         elif "d" in mem_size:
-            mem_args.append("-d")
+            mem_args.append("d")
     # Parse comparison signedness
     cmp_sign = re.findall(r'cmp.(?:gt|ge|lt|le)(.)\(',
                           meta_instructions[pattern_index]["str"])
     if len(cmp_sign) == 1 and "u" in cmp_sign:
-        mem_args.append("-u")
+        mem_args.append("u")
     # Parse jump flag
     jumps = re.findall(r'jump', meta_instructions[pattern_index]["str"])
     if len(jumps) > 0:
-        mem_args.append("-j")
+        mem_args.append("j")
     # Parse stop instruction
     if meta_instructions[pattern_index]["str"] == "stop(Rs)":
-        mem_args.append("-s")
-    args = [semantics_path] + mem_args
-    proc = subprocess.Popen(" ".join(args),
-                            shell=True,
-                            stdout=subprocess.PIPE,
-                            stderr=subprocess.PIPE,
-                            stdin=subprocess.PIPE)
-    proc.stdin.write(instruction_code.encode("utf-8"))
-    proc.stdin.close()
-    proc.wait()
+        mem_args.append("s")
+    return (mem_args, instruction_code)
+
+
+# Mark calls and returns, which the translator predicts with the return
+# address stack
+def gen_call_return(pattern_index):
+    string = meta_instructions[pattern_index]["str"]
+    if re.search(r'\bcallr?\b', string):
+        return "SET_CALL(dc);\n"
+    if "dealloc_return" in string or re.search(r'jumpr(:<hint>)? R31', string):
+        return "SET_RETURN(dc);\n"
+    if re.search(r'jumpr(:<hint>)? Rs', string):
+        return "if (s == 31) {\nSET_RETURN(dc);\n}\n"
+    return ""
+
+
+# Pass the :t and :nt static hints of the direct jumps to the superblock
+# formation, :nt being the default
+def gen_branch_hint(pattern_index):
+    string = meta_instructions[pattern_index]["str"]
+    if "jump:<hint>" in string:
+        return "SET_BRANCH_HINT(dc, hint);\n"
+    if "jump:t" in string:
+        return "SET_BRANCH_HINT(dc, true);\n"
+    return ""
+
+
+# Fill function body with the output of the semantics compiler
+def gen_function_body(pattern_index, result):
+    global implemented_meta
+    global implemented_insn
+    global implemented_vect
+    qemu_code = ""
+    qemu_code += "regs_t regs = { 0 };\n"
+    returncode, output = result
     # Check bison exit code
-    if proc.returncode == 0:
-        qemu_code += proc.stdout.read().decode("utf-8")
+    if returncode == 0:
+        qemu_code += gen_call_return(pattern_index)
+        qemu_code += gen_branch_hint(pattern_index)
+        if "USR.LPCFG=" in meta_instructions[pattern_index]["code"]:
+            qemu_code += "SET_LPCFG_WRITTEN(dc);\n"
+        qemu_code += output
         implemented_meta += 1
         implemented_insn += len(meta_mapping[pattern_index])
         if "=v" in meta_instructions[pattern_index]["str"]:
@@ -643,11 +767,218 @@ def gen_function_body(pattern_index):
     return qemu_code
 
 
+# Lifetime of the TCG temporaries in the code emitted by the semantics
+# compiler.  The code is parsed into a tree of C statements, each temporary
+# is freed right after the statement of its declaring block holding its last
+# use, so that TCG reuses it as soon as possible, and is made a local
+# temporary only if it lives across a label or a branch, where TCG discards
+# plain temporaries.
+
+TEMP_ALLOC = re.compile(r"^(TCGv(?:_i32|_i64)?) (\w+) = "
+                        r"tcg_(temp_new|temp_local_new|const|const_local)"
+                        r"(_i32|_i64)?\((.*)\);$")
+TEMP_FREE = re.compile(r"^tcg_temp_free(?:_i32|_i64)?\((\w+)\);$")
+BLOCK_END = re.compile(r"\b(?:gen_set_label|tcg_gen_br|tcg_gen_brcondi?_i(?:32|64))\(")
+CONTROL = re.compile(r"^(?:(?:if|for|while) ?\(.*\)|else)$")
+
+
+class TempLeak(Exception):
+    pass
+
+
+class Statement(object):
+    """Lines [first, last] of a C statement, and its nested blocks."""
+
+    def __init__(self, first, last, blocks, is_loop):
+        self.first = first
+        self.last = last
+        self.blocks = blocks
+        self.is_loop = is_loop
+
+
+# One statement per line: split the lines holding several statements and
+# join the calls the compiler split over several lines
+def split_statements(code):
+    lines = []
+    current = ""
+    depth = 0
+    for line in code.splitlines():
+        for c in line.strip():
+            current += c
+            if c == "(":
+                depth += 1
+            elif c == ")":
+                depth -= 1
+            elif depth == 0 and c in ";{}":
+                lines.append(current.strip())
+                current = ""
+        if depth == 0 and CONTROL.match(current.strip()):
+            lines.append(current.strip())
+            current = ""
+    assert(not current.strip() and "Unterminated statement!")
+    return lines
+
+
+def parse_block(lines, i):
+    statements = []
+    while i < len(lines) and not lines[i].startswith("}"):
+        statement, i = parse_statement(lines, i)
+        statements.append(statement)
+    return statements, i
+
+
+def parse_statement(lines, i):
+    first = i
+    line = lines[i]
+    is_loop = line.startswith("for") or line.startswith("while")
+    blocks = []
+    if line.endswith("{"):
+        # Braced body, "} else {" continues the statement
+        while True:
+            block, i = parse_block(lines, i + 1)
+            blocks.append(block)
+            if not lines[i].endswith("{"):
+                break
+        last = i
+        i += 1
+    elif CONTROL.match(line):
+        body, i = parse_statement(lines, i + 1)
+        blocks.append([body])
+        last = body.last
+    else:
+        last = i
+        i += 1
+    if line.startswith("if") and i < len(lines) and lines[i].startswith("else"):
+        alternative, i = parse_statement(lines, i)
+        blocks.append([alternative])
+        last = alternative.last
+    return Statement(first, last, blocks, is_loop), i
+
+
+# Index of the statement of block containing line, None if there is none
+def statement_at(block, line):
+    for index, statement in enumerate(block):
+        if statement.first <= line <= statement.last:
+            return index
+    return None
+
+
+def used_in(lines, name):
+    pattern = re.compile(r"\b" + name + r"\b")
+    return [i for i, line in enumerate(lines) if pattern.search(line)]
+
+
+def allocate_block(lines, block, frees):
+    for index, statement in enumerate(block):
+        for nested in statement.blocks:
+            allocate_block(lines, nested, frees)
+        declaration = TEMP_ALLOC.match(lines[statement.first])
+        if declaration is None:
+            continue
+        tcg_type, name, kind, suffix, value = declaration.groups()
+        uses = [i for i in used_in(lines, name)
+                if statement.first < i <= block[-1].last and
+                not TEMP_FREE.match(lines[i])]
+        if not uses:
+            # Never read: drop the allocation altogether
+            lines[statement.first] = ""
+            continue
+        end = block[statement_at(block, uses[-1])]
+        # The value survives a block end between definition and last use,
+        # or one anywhere in a loop re-executing the last use
+        live_end = end.last if end.is_loop else uses[-1]
+        local = any(BLOCK_END.search(lines[i])
+                    for i in range(statement.first + 1, live_end))
+        if kind in ("temp_new", "temp_local_new"):
+            kind = "temp_local_new" if local else "temp_new"
+        else:
+            kind = "const_local" if local else "const"
+        lines[statement.first] = "{} {} = tcg_{}{}({});".format(
+            tcg_type, name, kind, suffix or "", value)
+        frees[end.last].append("tcg_temp_free{}({});".format(suffix or "",
+                                                             name))
+
+
+# Check that every temporary is freed exactly once, in its declaring block,
+# and is not used afterwards
+def check_block(lines, block, live):
+    declared = []
+    for statement in block:
+        line = lines[statement.first]
+        declaration = TEMP_ALLOC.match(line)
+        free = TEMP_FREE.match(line)
+        if declaration is not None:
+            declared.append(declaration.group(2))
+            live.add(declaration.group(2))
+        elif free is not None:
+            if free.group(1) not in declared or free.group(1) not in live:
+                raise TempLeak("{} freed twice or outside its block"
+                               .format(free.group(1)))
+            live.remove(free.group(1))
+        else:
+            text = " ".join(lines[statement.first:statement.last + 1])
+            for name in re.findall(r"\b\w+\b", text):
+                if name in declared and name not in live:
+                    raise TempLeak("{} used after being freed".format(name))
+            for nested in statement.blocks:
+                check_block(lines, nested, live)
+    leaked = [name for name in declared if name in live]
+    if leaked:
+        raise TempLeak("{} not freed".format(", ".join(leaked)))
+
+
+def allocate_temps(code):
+    lines = split_statements(code)
+    # The frees emitted by the semantics compiler are recomputed
+    names = set(m.group(2) for m in map(TEMP_ALLOC.match, lines) if m)
+    lines = [line for line in lines
+             if not (TEMP_FREE.match(line) and
+                     TEMP_FREE.match(line).group(1) in names)]
+    block, end = parse_block(lines, 0)
+    assert(end == len(lines) and "Unbalanced braces!")
+    frees = defaultdict(list)
+    allocate_block(lines, block, frees)
+    code = ""
+    for i, line in enumerate(lines):
+        if line:
+            code += line + "\n"
+        for free in frees[i]:
+            code += free + "\n"
+    lines = code.splitlines()
+    check_block(lines, parse_block(lines, 0)[0], set())
+    return code
+
+
+# Apply allocate_temps() to the successful results of run_semantics()
+def allocate_results(names, results):
+    allocated = []
+    for name, (returncode, output) in zip(names, results):
+        if returncode == 0:
+            try:
+                output = allocate_temps(output)
+            except TempLeak as e:
+                sys.exit("{}: TCG temporary leak: {}".format(name, e))
+        allocated.append((returncode, output))
+    return allocated
+
+
+# Count the TCG temporaries allocated and the TCG ops emitted by generated
+# code, constants count as both since tcg_const_*() emits a movi
+def tcg_usage(code):
+    consts = len(re.findall(r"\btcg_const_\w+\(", code))
+    temps = len(re.findall(r"\btcg_temp_(?:local_)?new\w*\(", code))
+    ops = len(re.findall(r"\btcg_gen_\w+\(", code))
+    return temps + consts, ops + consts
+
+
 # Generate functions signatures
 def gen_functions():
-    code = ""
     regexes = map(to_regex, meta_instructions)
     patterns = map(re.compile, regexes)
+    results = run_semantics([semantics_request(i)
+                             for i in range(len(meta_instructions))])
+    results = allocate_results([meta["str"] for meta in meta_instructions],
+                               results)
     # Map meta-instructions into effective instructions
     for pattern_index, pattern in enumerate(patterns):
         meta_instruction = meta_instructions[pattern_index]["str"]
@@ -657,7 +988,7 @@ def gen_functions():
         identifiers = [op.identifier for op in operands]
         params = get_params(pattern)
         # Add function string comment
-        code += "/* " + meta_instructions[pattern_index]["str"] + " */\n"
+        code = "/* " + meta_instructions[pattern_index]["str"] + " */\n"
         code += "/* " + meta_instructions[pattern_index]["code"] + " */\n"
         # Generate function signature
         if len(identifiers) + len(params) == 0:
@@ -669,14 +1000,19 @@ def gen_functions():
             code += function_str.format(pattern_index,
                                         *identifiers,
                                         *params)
-        code += gen_function_body(pattern_index)
+        code += gen_function_body(pattern_index, results[pattern_index])
         code += "}\n"
-    with open(decoder_c, "a") as d:
-        d.write(code)
+        function_bodies.append(code)
+    if shards == 0:
+        with open(decoder_c, "a") as d:
+            d.write("".join(function_bodies))
     print("{}/{} meta instructions are vectorial!".format(vectorial_meta, len(meta_instructions)))
     print("{}/{} meta instructions have been implemented!".format(implemented_meta, len(meta_instructions)))
     print("{}/{} vectorial meta instructions have been implemented!".format(implemented_vect, vectorial_meta))
     print("{}/{} instructions have been implemented!".format(implemented_insn, len(instruction_strings) - system_insn - float_insn))
+    temps, ops = tcg_usage("".join(output for returncode, output in results
+                                   if returncode == 0))
+    print("Semantic functions allocate {} TCG temporaries and emit {} TCG ops".format(temps, ops))
 
 # Match instructions corresponding to a meta-instruction
 def gen_pattern_matching(candidates, instruction_masks):
@@ -885,7 +1221,7 @@ def parse_meta_instructions():
     return meta_instructions
 
 
-def gen_function_call(inst_str, identifiers):
+def gen_function_call(inst_str, identifiers, inst_id=None, mapping=None):
     inst_str = inst_str.replace(" ", "")
     arguments = identifiers
     pattern_id = None
@@ -897,11 +1233,13 @@ def gen_function_call(inst_str, identifiers):
             for group in match.groups():
                 arguments.append("true" if group in {"&", "+", "1", "!", "H",
                                                      ":sat", ":rnd", ".new",
-                                                     "t"} else "false")
+                                                     ":t"} else "false")
             pattern_id = i
             break
     if matched:
         meta_mapping[pattern_id].append(inst_str)
+        if mapping is not None:
+            mapping[inst_id] = pattern_id
         return ("regs = function_{}(dc" +
                 ", {}" * len(identifiers) +
                 ");\n").format(pattern_id, *arguments)
@@ -959,7 +1297,8 @@ def gen_sub_execute():
                  ", {}" * len(format_identifiers) +
                  ");\n").format(to_format_string(inst_str), *format_identifiers)
         # Call the correct semantics function
-        code += gen_function_call(inst_str, identifiers)
+        code += gen_function_call(inst_str, identifiers, inst_id,
+                                  sub_inst_meta)
         code += "break;\n}\n"
 
     code += 'default: assert(false && '\
@@ -971,25 +1310,89 @@ def gen_sub_execute():
         d.write(code)
 
 
+# Update of the pipelined loops set up by spNloop0, left out of the endloop
+# variants used when the translation block flags tell USR.LPCFG is zero
+LPCFG_UPDATE = ("if (USR.LPCFG) {if (USR.LPCFG==1) {P3=0xff;};"
+                "USR.LPCFG=USR.LPCFG-1;};")
+
+
 def gen_endloop():
     code = ""
+    variants = {}
     for name, pseudocode in endloops.items():
+        variants[name] = pseudocode
+        pseudocode = pseudocode.replace("\n", "")
+        if pseudocode.startswith(LPCFG_UPDATE):
+            variants[name + "_lpcfg_zero"] = pseudocode[len(LPCFG_UPDATE):]
+    results = run_semantics([(["t"], pseudocode)
+                             for pseudocode in variants.values()])
+    results = allocate_results(variants.keys(), results)
+    for name, (returncode, output) in zip(variants.keys(), results):
         code += "void "+name+"(void)\n"
         code += "{\n"
-        proc = subprocess.Popen([semantics_path,
-                                 '-t'],
-                                stdout=subprocess.PIPE,
-                                stdin=subprocess.PIPE)
-        proc.stdin.write(pseudocode.encode("utf-8"))
-        proc.stdin.close()
-        proc.wait()
-        assert(proc.returncode == 0 and "Unhandled endloop instruction!")
-        code += proc.stdout.read().decode("utf-8")
+        assert(returncode == 0 and "Unhandled endloop instruction!")
+        code += output
         code += "}\n"
     with open(decoder_c, "a") as d:
         d.write(code)
 
 
+# Execution frequency of each meta-instruction, from a profile listing
+# "ID COUNT" for the instructions of instructions.csv, as numbered by
+# decode(), and "sub:ID COUNT" for the sub-instructions
+def read_profile(filename):
+    frequency = defaultdict(int)
+    with open(filename) as f:
+        for line in f:
+            fields = line.split("#", 1)[0].split()
+            if len(fields) == 0:
+                continue
+            mapping = inst_meta
+            inst_id = fields[0]
+            if inst_id.startswith("sub:"):
+                mapping = sub_inst_meta
+                inst_id = inst_id[len("sub:"):]
+            if int(inst_id) in mapping:
+                frequency[mapping[int(inst_id)]] += int(fields[1])
+    return frequency
+
+
+def shard_name(index):
+    base, ext = os.path.splitext(decoder_c)
+    return "{}-{}{}".format(base, index, ext)
+
+
+# Spread the semantic functions over the shards, balancing their size.  With
+# a profile the executed functions go first, hottest first, in shard 0 and
+# are marked hot, so that the compiler also groups them in .text.hot.
+def gen_shards():
+    if shards == 0:
+        return
+    order = list(range(len(function_bodies)))
+    frequency = read_profile(profile) if profile else {}
+    hot = sorted((i for i in order if frequency.get(i, 0) > 0),
+                 key=lambda i: (-frequency[i], i))
+    cold = [i for i in order if frequency.get(i, 0) == 0]
+
+    contents = [[] for _ in range(shards)]
+    sizes = [0] * shards
+    for i in hot:
+        contents[0].append("__attribute__((hot))\n" + function_bodies[i])
+        sizes[0] += len(function_bodies[i])
+    for i in cold:
+        shard = min(range(shards), key=lambda k: sizes[k])
+        contents[shard].append(function_bodies[i])
+        sizes[shard] += len(function_bodies[i])
+
+    for index, functions in enumerate(contents):
+        with open(shard_name(index), "w") as f:
+            f.write(DECODER_INCLUDES)
+            f.write("".join(functions))
+    if hot:
+        print("{} hot meta instructions placed first in {}".format(
+              len(hot), shard_name(0)))
+
+
 def analyse_inst_mapping():
     no_match_count = 0
     regexes = map(to_regex, meta_instructions)
@@ -1048,10 +1451,12 @@ def gen_decoder_header():
 
 def indent():
     # Optionally, indent
-    try:
-        subprocess.run("indent -linux " + decoder_c, shell=True, check=True)
-    except:
-        pass
+    for filename in [decoder_c] + [shard_name(i) for i in range(shards)]:
+        try:
+            subprocess.run("indent -linux " + filename, shell=True,
+                           check=True)
+        except:
+            pass
 
 def main():
     parser = argparse.ArgumentParser()
@@ -1072,7 +1477,17 @@ def main():
     parser.add_argument("decoder_c", metavar="DECODER_C")
     parser.add_argument("decoder_h", metavar="DECODER_H")
 
+    parser.add_argument("-j", "--jobs", type=int, default=os.cpu_count(),
+                        help="number of semantics compiler workers")
+    parser.add_argument("--shards", type=int, default=0,
+                        help="emit the semantic functions in SHARDS files "
+                        "named after DECODER_C, instead of DECODER_C itself")
+    parser.add_argument("--profile", metavar="PROFILE",
+                        help="instruction execution counts, used to lay "
+                        "out the hottest semantic functions together")
+
     args = parser.parse_args()
+    start_time = time.time()
 
     global semantics_path
     global meta_instructions_csv
@@ -1083,6 +1498,9 @@ def main():
     global sub_instruction_decoding_json
     global decoder_c
     global decoder_h
+    global jobs
+    global shards
+    global profile
     semantics_path = args.semantics
     meta_instructions_csv = args.meta_instructions_csv
     instructions_csv = args.instructions_csv
@@ -1092,6 +1510,9 @@ def main():
     sub_instruction_decoding_json = args.sub_instruction_decoding_json
     decoder_c = args.decoder_c
     decoder_h = args.decoder_h
+    jobs = max(args.jobs or 1, 1)
+    shards = max(args.shards, 0)
+    profile = args.profile
 
     global meta_instructions
     global instruction_strings
@@ -1115,8 +1536,11 @@ def main():
     gen_sub_decoder()
     gen_sub_execute()
     gen_endloop()
+    gen_shards()
     # auto-indent
     indent()
+    print("Generated {} in {:.2f}s with {} semantics "
+          "workers".format(decoder_c, time.time() - start_time, jobs))
 
 if __name__ == "__main__":
     main()
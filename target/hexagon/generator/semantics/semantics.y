@@ -72,6 +72,9 @@ int written_index = 0;
 
 extern void yyerror(const char *s);
 extern int error_count;
+extern FILE *yyin;
+extern int yylineno;
+extern void yyrestart(FILE *input_file);
 
 /* Print functions */
 void str_print(const char *string) {
@@ -383,6 +386,35 @@ enum cmp_type cmp_swap(enum cmp_type type) {
     }
 }
 
+/* C operator of a comparison, for folding it at translation time */
+const char *cmp_c_op(enum cmp_type type) {
+    switch(type) {
+        case EQ_OP:
+            return "==";
+        case NEQ_OP:
+            return "!=";
+        case LT_OP:
+        case LTU_OP:
+            return "<";
+        case GT_OP:
+        case GTU_OP:
+            return ">";
+        case LTE_OP:
+        case LEU_OP:
+            return "<=";
+        case GTE_OP:
+        case GEU_OP:
+            return ">=";
+        default:
+            assert(false && "Unhandled comparison operator!");
+    }
+}
+
+bool cmp_is_unsigned(enum cmp_type type) {
+    return type == LTU_OP || type == GTU_OP ||
+           type == LEU_OP || type == GEU_OP;
+}
+
 t_hex_value gen_extra(enum rvalue_extra_type type, int index, bool temp) {
     t_hex_value rvalue;
     rvalue.type = EXTRA;
@@ -468,6 +500,14 @@ t_hex_value gen_imm_value(int value, int bit_width) {
     return rvalue;
 }
 
+/* Immediate held by a C variable of the generated code, e.g. a loop index */
+t_hex_value gen_imm_var(char id, int bit_width) {
+    t_hex_value rvalue = gen_imm_value(0, bit_width);
+    rvalue.imm.type = VARIABLE;
+    rvalue.imm.id = id;
+    return rvalue;
+}
+
 void rvalue_free(t_hex_value *rvalue) {
     if (rvalue->type == TEMP) {
         char * bit_suffix = (rvalue->bit_width == 64) ? "i64" : "i32";
@@ -555,7 +595,7 @@ void reg_set_written(t_hex_value *reg, int offset) {
     written_regs[written_index] = reg->reg.id;
     written_index++;
     if (!no_track_regs)
-        OUT("SET_USED_REG(regs, ");
+        OUT("SET_USED_REG(dc, regs, ");
     if (offset != 0) {
         char *sign = (offset > 0) ? " + " : " - ";
         int abs_offset = abs(offset);
@@ -749,11 +789,18 @@ t_hex_value gen_bin_op(enum op_type type,
         }
         case ASHIFTL:
         {
+            /* Hexagon clears the register when shifting left by 64; with
+               an immediate amount that is decided at translation time */
             switch(op_types) {
                 case IMM_IMM:
-                    OUT("int", &bit_width, "_t ", &res, " = ", op1, " << ", op2, ";\n");
+                    OUT("int", &bit_width, "_t ", &res, " = (", op2, " >= ");
+                    OUT(&bit_width, ") ? 0 : (int", &bit_width, "_t)", op1);
+                    OUT(" << ", op2, ";\n");
                     break;
                 case REG_IMM:
+                    OUT("if (", op2, " >= ", &bit_width, ")\n");
+                    OUT("tcg_gen_movi_", bit_suffix, "(", &res, ", 0);\n");
+                    OUT("else\n");
                     OUT("tcg_gen_shli_", bit_suffix, "(", &res, ", ", op1, ", ", op2, ");\n");
                     break;
                 case IMM_REG:
@@ -766,21 +813,14 @@ t_hex_value gen_bin_op(enum op_type type,
                     fprintf(stderr, "Error in evalutating immediateness!");
                     abort();
             }
-            if (op_types != IMM_IMM) {
+            if (op_types == IMM_REG || op_types == REG_REG) {
                 /* Handle left shift by 64 which hexagon-sim expects to clear out register */
                 t_hex_value edge = gen_tmp_value("64", bit_width);
                 t_hex_value zero = gen_tmp_value("0", bit_width);
                 if (op_is64bit)
                     rvalue_extend(op2);
-                rvalue_materialize(op1);
-                rvalue_materialize(op2);
-                op2->is_symbol = true;
-                rvalue_materialize(&edge);
                 OUT("tcg_gen_movcond_i", &bit_width);
-                if (op_types == REG_REG || op_types == IMM_REG)
-                    OUT("(TCG_COND_EQ, ", &res, ", ", op2, ", ", &edge);
-                else
-                    OUT("(TCG_COND_EQ, ", &res, ", ", op2, ", ", &edge);
+                OUT("(TCG_COND_EQ, ", &res, ", ", op2, ", ", &edge);
                 OUT(", ", &zero, ", ", &res, ");\n");
                 rvalue_free(&edge);
                 rvalue_free(&zero);
@@ -791,7 +831,8 @@ t_hex_value gen_bin_op(enum op_type type,
         {
             switch(op_types) {
                 case IMM_IMM:
-                    OUT("int", &bit_width, "_t ", &res, " = ", op1, " >> ", op2, ";\n");
+                    OUT("int", &bit_width, "_t ", &res, " = (int", &bit_width, "_t)");
+                    OUT(op1, " >> ", op2, ";\n");
                     break;
                 case REG_IMM:
                     OUT("tcg_gen_sari_", bit_suffix, "(", &res, ", ", op1, ", ", op2, ");\n");
@@ -812,7 +853,8 @@ t_hex_value gen_bin_op(enum op_type type,
         {
             switch(op_types) {
                 case IMM_IMM:
-                    OUT("int", &bit_width, "_t ", &res, " = ", op1, " >> ", op2, ";\n");
+                    OUT("int", &bit_width, "_t ", &res, " = (uint", &bit_width, "_t)");
+                    OUT(op1, " >> ", op2, ";\n");
                     break;
                 case REG_IMM:
                     OUT("tcg_gen_shri_", bit_suffix, "(", &res, ", ", op1, ", ", op2, ");\n");
@@ -833,7 +875,10 @@ t_hex_value gen_bin_op(enum op_type type,
         {
             switch(op_types) {
                 case IMM_IMM:
-                    OUT("int", &bit_width, "_t ", &res, " = ", op1, " >> ", op2, ";\n");
+                    OUT("int", &bit_width, "_t ", &res, " = ((uint", &bit_width, "_t)");
+                    OUT(op1, " << ", op2, ") | ((uint", &bit_width, "_t)", op1);
+                    OUT(" >> ((", &bit_width, " - ", op2, ") & ", &bit_width);
+                    OUT(" - 1));\n");
                     break;
                 case REG_IMM:
                     OUT("tcg_gen_rotli_", bit_suffix, "(", &res, ", ", op1, ", ", op2, ");\n");
@@ -875,7 +920,7 @@ t_hex_value gen_bin_op(enum op_type type,
         {
             switch(op_types) {
                 case IMM_IMM:
-                    OUT("int", &bit_width, "_t ", &res, " = ", op1, " & ", op2, ";\n");
+                    OUT("int", &bit_width, "_t ", &res, " = ", op1, " | ", op2, ";\n");
                     break;
                 case IMM_REG:
                     OUT("tcg_gen_ori_", bit_suffix, "(", &res, ", ", op2, ", ", op1, ");\n");
@@ -927,7 +972,7 @@ t_hex_value gen_bin_op(enum op_type type,
         {
             switch(op_types) {
                 case IMM_IMM:
-                    OUT("int", &bit_width, "_t ", &res, " = ", op1, " & ", op2, ";\n");
+                    OUT("int", &bit_width, "_t ", &res, " = ", op1, " ^ ", op2, ";\n");
                     break;
                 case IMM_REG:
                     OUT("tcg_gen_xori_", bit_suffix, "(", &res, ", ", op2, ", ", op1, ");\n");
@@ -1064,14 +1109,28 @@ t_hex_value gen_bin_cmp(enum cmp_type type,
         }
     }
 
+    /* Both operands are known at translation time, fold the comparison */
+    if (op_types == IMM_IMM) {
+        t_hex_value res = gen_imm_value(0, bit_width);
+        res.imm.type = QEMU_TMP;
+        res.imm.index = qemu_tmp_count;
+        char * sign = cmp_is_unsigned(type) ? "(uint" : "(int";
+        OUT("int", &bit_width, "_t ", &res, " = ");
+        if (type == OPTEQ_OP) {
+            OUT("not", &not_count, " ? (", op1, " != ", op2, ") : (");
+            OUT(op1, " == ", op2, ");\n");
+            not_count++;
+        } else {
+            OUT(sign, &bit_width, "_t)", op1, " ", cmp_c_op(type), " ");
+            OUT(sign, &bit_width, "_t)", op2, ";\n");
+        }
+        qemu_tmp_count++;
+        return res;
+    }
+
     t_hex_value res = gen_tmp(bit_width);
 
     switch(op_types) {
-        case IMM_IMM:
-        {
-            OUT("tcg_gen_movi_", bit_suffix, "(", &res, ", ", op1, " == ", op2, ");\n");
-            break;
-        }
         case IMM_REG:
         {
             t_hex_value swp = *op2;
@@ -1272,7 +1331,7 @@ void gen_deposit(t_hex_value *dest,
             snprintf(offset_string, OFFSET_STR_LEN, "(%s %% (32 / %d)) * %d", offset, width, width);
             offset = offset_string;
             // Emit conditional regs written
-            OUT("SET_USED_REG(regs, ", &(dest->reg.id), increment, ");\n");
+            OUT("SET_USED_REG(dc, regs, ", &(dest->reg.id), increment, ");\n");
             rvalue_truncate(value);
             rvalue_materialize(value);
             OUT("tcg_gen_deposit_i32(GPR_new[", &(dest->reg.id), increment);
@@ -1333,7 +1392,16 @@ void gen_assign(t_hex_value *dest, t_hex_value *value) {
         rvalue_free(value); /* Free temporary value */
         return;
     }
-    if (dest->bit_width == 64) {
+    if (dest->bit_width == 64 && value->type == IMMEDIATE) {
+        t_hex_value reg_new = *dest;
+        if (dest->reg.type != SYSTEM)
+            reg_new.is_dotnew = true;
+        OUT("tcg_gen_movi_i32(", &reg_new, ", (int32_t)", value, ");\n");
+        OUT("tcg_gen_movi_i32(GPR_new[", &(dest->reg.id), " + 1], ");
+        OUT("(int32_t)((int64_t)", value, " >> 32));\n");
+        reg_set_written(dest, 0);
+        reg_set_written(dest, 1);
+    } else if (dest->bit_width == 64) {
         rvalue_extend(value);
         rvalue_materialize(value);
         assert(value->bit_width == 64 &&
@@ -1674,13 +1742,8 @@ assign_statement  : lvalue ASSIGN rvalue
                          OUT("tcg_gen_shli_i32(", &$3, ", ", &$3, ", 8 * pre_index",
                              &predicate_count, " + i);\n");
                          /* Clear previous predicate value */
-                         t_hex_value mask = gen_tmp(32);
-                         t_hex_value one = gen_tmp_value("1", 32);
-                         OUT("tcg_gen_shli_i32(", &mask);
-                         OUT(", ", &one, ", 8 * pre_index", &predicate_count, " + i);\n");
-                         OUT("tcg_gen_not_i32(", &mask, ", ", &mask, ");\n");
-                         OUT("tcg_gen_and_i32(CR_new[CR_P], p_reg", &p_reg_count, ", ",
-                              &mask, ");\n");
+                         OUT("tcg_gen_andi_i32(CR_new[CR_P], p_reg", &p_reg_count,
+                             ", ~(1u << (8 * pre_index", &predicate_count, " + i)));\n");
                          p_reg_count++;
                          /* Store new predicate value */
                          if (no_track_regs) {
@@ -1696,13 +1759,11 @@ assign_statement  : lvalue ASSIGN rvalue
                          }
                     /* Range-based predicate assignment */
                     } else if ($1.is_range) {
-                        /* (bool) ? 0xff : 0x00 */
+                        /* (bool) ? 0xff : 0x00, only the low bits are deposited */
                         t_hex_value tmp = gen_tmp(32);
-                        t_hex_value zero = gen_tmp_value("0x0", 32);
-                        t_hex_value ff = gen_tmp_value("0xff", 32);
-                        OUT("tcg_gen_movcond_i32");
-                        OUT("(TCG_COND_EQ, ", &tmp, ", ", &$3, ", ", &zero);
-                        OUT(", ", &zero, ", ", &ff, ");\n");
+                        OUT("tcg_gen_setcondi_i32(TCG_COND_NE, ", &tmp, ", ");
+                        OUT(&$3, ", 0);\n");
+                        OUT("tcg_gen_neg_i32(", &tmp, ", ", &tmp, ");\n");
                         /* Deposit into range */
                         int begin = $1.range.begin;
                         int end = $1.range.end;
@@ -1712,8 +1773,6 @@ assign_statement  : lvalue ASSIGN rvalue
                         p_reg_count++;
                         OUT(&tmp, ", 8 * pre_index", &predicate_count, " + ");
                         OUT(&begin, ", ", &width, ");\n");
-                        rvalue_free(&zero);
-                        rvalue_free(&ff);
                         rvalue_free(&tmp);
                     /* Standard bytewise predicate assignment */
                     } else {
@@ -1759,7 +1818,7 @@ assign_statement  : lvalue ASSIGN rvalue
                         }
                     }
                     if (!no_track_regs) {
-                        OUT("SET_USED_REG(regs, CR_P + 32);\n");
+                        OUT("SET_USED_REG(dc, regs, CR_P + 32);\n");
                         OUT("SET_WRITTEN_PRE(dc, pre_index", &predicate_count, ");\n");
                     }
                     rvalue_free(&$3);  /* Free temporary value */
@@ -1780,13 +1839,17 @@ assign_statement  : lvalue ASSIGN rvalue
                   {
                     /* Do not assign PC if pc_written is 1 */
                     t_hex_value one = gen_tmp_value("1", 32);
+                    /* Direct branches can be followed by superblocks */
+                    if ($3.type == IMMEDIATE) {
+                        OUT("SET_BRANCH_TARGET(dc, ", &$3, ");\n");
+                    }
                     rvalue_materialize(&$3);
                     OUT("tcg_gen_movcond_i32(");
                     OUT("TCG_COND_EQ, CR[CR_PC], PC_written, ", &one, ", CR[CR_PC]");
                     OUT(", ", &$3, ");\n");
                     /* Update PC_written */
                     if (!no_track_regs) {
-                        OUT("SET_USED_REG(regs, CR_PC + 32);\n");
+                        OUT("SET_USED_REG(dc, regs, CR_PC + 32);\n");
                     }
                     OUT("tcg_gen_addi_i32(PC_written, PC_written, 1);\n");
                     rvalue_free(&$3); /* Free temporary value */
@@ -1865,27 +1928,27 @@ stop_statement : IF DEBUG MODECTL ASSIGN IMM SEMI { /* does nothing */ }
 
 trap_statement    : TRAP0 SEMI
                   {
-                    t_hex_value tmp = gen_tmp_value("j", 32);
-                    /* Put next program counter in ELR register */
-                    OUT("tcg_gen_movi_i32(SR[3], dc->pc + 4);\n");
+                    /* Put the address of the next packet in ELR register */
+                    OUT("tcg_gen_movi_i32(SR[3], dc->npc);\n");
                     /* Jump to interrupt handler */
                     t_hex_value handler_pc = gen_tmp(32);
                     OUT("tcg_gen_addi_i32(", &handler_pc, ", SR[16], 0x1c);\n");
                     OUT("tcg_gen_mov_i32(CR[CR_PC], ", &handler_pc, ");\n");
-                    OUT("gen_helper_handle_trap(cpu_env, ", &tmp, ");\n");
-                    rvalue_free(&tmp);
+                    /* Raised once the whole packet has committed */
+                    OUT("dc->trap = true;\n");
+                    OUT("dc->trap_index = j;\n");
                   }
                   | TRAP1 SEMI
                   {
-                    t_hex_value tmp = gen_tmp_value("j", 32);
-                    /* Put next program counter in ELR register */
-                    OUT("tcg_gen_movi_i32(SR[3], dc->pc + 4);\n");
+                    /* Put the address of the next packet in ELR register */
+                    OUT("tcg_gen_movi_i32(SR[3], dc->npc);\n");
                     /* Jump to interrupt handler */
                     t_hex_value handler_pc = gen_tmp(32);
                     OUT("tcg_gen_addi_i32(", &handler_pc, ", SR[16], 0x20);\n");
                     OUT("tcg_gen_mov_i32(CR[CR_PC], ", &handler_pc, ");\n");
-                    OUT("gen_helper_handle_trap(cpu_env, ", &tmp, ");\n");
-                    rvalue_free(&tmp);
+                    /* Raised once the whole packet has committed */
+                    OUT("dc->trap = true;\n");
+                    OUT("dc->trap_index = j;\n");
                   }
 ;
 
@@ -1934,16 +1997,19 @@ for_statement : FOR LPAR I ASSIGN IMM SEMI I LT IMM SEMI I INC IMM RPAR
 if_stmt      : IF
              {
                if (!no_track_regs)
-                 OUT("SET_BEGIN_COND();\n");
+                 OUT("SET_BEGIN_COND(dc);\n");
                /* Generate an end label, if false branch to that label */
                OUT("TCGLabel *if_label_", &if_count, " = gen_new_label();\n");
              }
              LPAR rvalue RPAR
              {
-               rvalue_materialize(&$4);
                char * bit_suffix = ($4.bit_width == 64) ? "i64" : "i32";
-               OUT("tcg_gen_brcondi_", bit_suffix, "(TCG_COND_EQ, ", &$4,
-                   ", 0, if_label_", &if_count, ");\n");
+               if ($4.type == IMMEDIATE)
+                   OUT("if (!(", &$4, "))\ntcg_gen_br(if_label_", &if_count,
+                       ");\n");
+               else
+                   OUT("tcg_gen_brcondi_", bit_suffix, "(TCG_COND_EQ, ", &$4,
+                       ", 0, if_label_", &if_count, ");\n");
                rvalue_free(&$4);
                $1 = if_count;
                if_count++;
@@ -1951,7 +2017,7 @@ if_stmt      : IF
              code_block
              {
                if (!no_track_regs)
-                 OUT("SET_END_COND();\n");
+                 OUT("SET_END_COND(dc);\n");
                $$ = $1;
              }
 ;
@@ -2163,14 +2229,12 @@ rvalue            : assign_statement            { /* does nothing */ }
                         $$ = res;
                     } else {
                         res = gen_tmp(bit_width);
-                        t_hex_value zero = gen_tmp_value("0", bit_width);
-                        t_hex_value one = gen_tmp_value("0xff", bit_width);
-                        OUT("tcg_gen_movcond_", bit_suffix);
-                        OUT("(TCG_COND_EQ, ", &$$, ", ", &$2, ", ", &zero);
-                        OUT(", ", &one, ", ", &zero, ");\n");
+                        /* (x == 0) ? 0xff : 0 */
+                        OUT("tcg_gen_setcondi_", bit_suffix, "(TCG_COND_EQ, ");
+                        OUT(&res, ", ", &$2, ", 0);\n");
+                        OUT("tcg_gen_muli_", bit_suffix, "(", &res, ", ");
+                        OUT(&res, ", 0xff);\n");
                         rvalue_free(&$2);
-                        rvalue_free(&zero);
-                        rvalue_free(&one);
                         $$ = res;
                     }
                   }
@@ -2178,13 +2242,10 @@ rvalue            : assign_statement            { /* does nothing */ }
                   {
                     char * bit_suffix = ($2.bit_width == 64) ? "i64" : "i32";
                     OUT("if (not", &not_count, ") {\n");
-                    t_hex_value zero = gen_tmp_value("0", 32);
-                    t_hex_value one = gen_tmp_value("0xff", 32);
-                    OUT("tcg_gen_movcond_", bit_suffix);
-                    OUT("(TCG_COND_EQ, ", &$2, ", ", &$2, ", ", &zero);
-                    OUT(", ", &one, ", ", &zero, ");\n");
-                    rvalue_free(&zero);
-                    rvalue_free(&one);
+                    OUT("tcg_gen_setcondi_", bit_suffix, "(TCG_COND_EQ, ");
+                    OUT(&$2, ", ", &$2, ", 0);\n");
+                    OUT("tcg_gen_muli_", bit_suffix, "(", &$2, ", ");
+                    OUT(&$2, ", 0xff);\n");
                     OUT("}\n");
                     not_count++;
                     $$ = $2;
@@ -2327,7 +2388,6 @@ rvalue            : assign_statement            { /* does nothing */ }
                     if ($2.type != IMMEDIATE || $2.imm.value != $6.bit_width) {
                         // Cast $2 bit width to $6 bit width
                         $2 = gen_cast_op(&$2, $6.bit_width);
-                        rvalue_materialize(&$2);
                         /* First zero-out unwanted bits */
                         t_hex_value reg = reg_concat(&$6);
                         t_hex_value one = gen_imm_value(1, $6.bit_width);
@@ -2471,7 +2531,7 @@ rvalue            : assign_statement            { /* does nothing */ }
                   }
                   | rvalue NSHIFT
                   {
-                    t_hex_value N = gen_tmp_value("N", 32);
+                    t_hex_value N = gen_imm_var('N', 32);
                     $$ = gen_bin_op(ASHIFTL, &$1, &N);
                   }
                   | CIRCADD LPAR rvalue COMMA rvalue COMMA rvalue RPAR
@@ -2674,33 +2734,29 @@ extra             : LPCFG
                   }
                   | I
                   {
-                    $$ = gen_tmp_value("i", 32);
+                    $$ = gen_imm_var('i', 32);
                   }
 ;
 
 %%
 
-int main(int argc, char **argv)
+static void set_option(int opt)
 {
-    
-    /* Argument parsing */
-    int opt;
-    while ((opt = getopt(argc, argv, "jstulbhwd")) != -1) {
-        switch (opt) {
-        case 'j': is_jump = true; break;
-        case 's': is_stop = true; break;
-        case 't': no_track_regs = true; break;
-        case 'u': mem_unsigned = true; break;
-        case 'b': mem_size = MEM_BYTE; break;
-        case 'h': mem_size = MEM_HALF; break;
-        case 'w': mem_size = MEM_WORD; break;
-        case 'd': mem_size = MEM_DOUBLE; break;
-        default:
-            fprintf(stderr, "Usage: %s [-nbhwd]\n", argv[0]);
-            exit(EXIT_FAILURE);
-        }
+    switch (opt) {
+    case 'j': is_jump = true; break;
+    case 's': is_stop = true; break;
+    case 't': no_track_regs = true; break;
+    case 'u': mem_unsigned = true; break;
+    case 'b': mem_size = MEM_BYTE; break;
+    case 'h': mem_size = MEM_HALF; break;
+    case 'w': mem_size = MEM_WORD; break;
+    case 'd': mem_size = MEM_DOUBLE; break;
     }
+}
 
+/* Translate the semantics read from yyin, returns the exit code */
+static int translate(void)
+{
     /* Emit fake jump dependency */
     if (is_jump)
         OUT("SET_JUMP_FLAG(dc);\n");
@@ -2721,3 +2777,111 @@ int main(int argc, char **argv)
     }
     return 0;
 }
+
+/* Back to the state of a fresh process, for the next batch request */
+static void reset_state(void)
+{
+    tmp_count = 0;
+    qemu_tmp_count = 0;
+    not_count = 0;
+    zeroone_count = 0;
+    predicate_count = 0;
+    highlow_count = 0;
+    p_reg_count = 0;
+    if_count = 0;
+    no_track_regs = false;
+    memset(is_extra_created, 0, sizeof(is_extra_created));
+    ea_declared = false;
+    is_jump = false;
+    is_stop = false;
+    mem_unsigned = false;
+    mem_size = MEM_DOUBLE;
+    memset(written_regs, 0, sizeof(written_regs));
+    written_index = 0;
+    error_count = 0;
+    yylineno = 1;
+}
+
+/*
+ * Batch mode, used by decoder_gen.py to avoid spawning one process per
+ * meta-instruction.  Requests are read from stdin as
+ *
+ *   <option letters, or "-"> <length>\n<semantics>
+ *
+ * and each is answered on stdout with
+ *
+ *   <exit code> <length>\n<generated code>
+ *
+ * where the exit code is the one of a single-shot run.  All the requests
+ * are translated in this process, the globals being reset in between, and
+ * the generated code is collected in memory so that only complete answers
+ * reach stdout.  The parser still gives up on unsupported input with
+ * assert() and abort(): the process then dies without answering, and
+ * decoder_gen.py counts the request as failed and starts a new one for
+ * the rest of the batch.
+ */
+static int batch(void)
+{
+    FILE *out_stream = stdout;
+    char flags[16];
+    size_t len;
+
+    while (scanf("%15s %zu", flags, &len) == 2) {
+        char *code = malloc(len);
+        char *out = NULL;
+        size_t out_len = 0;
+        int status;
+
+        /* Skip the newline that ends the header */
+        if (getchar() != '\n' || code == NULL ||
+            fread(code, 1, len, stdin) != len) {
+            fprintf(stderr, "semantics: malformed batch request\n");
+            return 1;
+        }
+
+        reset_state();
+        for (char *f = flags; *f != '\0'; f++) {
+            set_option(*f);
+        }
+        yyin = fmemopen(code, len, "r");
+        yyrestart(yyin);
+        /* The printing functions write to stdout */
+        stdout = open_memstream(&out, &out_len);
+        assert(yyin != NULL && stdout != NULL);
+        status = translate();
+        fclose(stdout);
+        stdout = out_stream;
+        fclose(yyin);
+
+        printf("%d %zu\n", status, out_len);
+        fwrite(out, 1, out_len, stdout);
+        fflush(stdout);
+        free(out);
+        free(code);
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    bool is_batch = false;
+
+    /* Argument parsing */
+    int opt;
+    while ((opt = getopt(argc, argv, "Bjstulbhwd")) != -1) {
+        switch (opt) {
+        case 'B': is_batch = true; break;
+        case 'j': case 's': case 't': case 'u':
+        case 'b': case 'h': case 'w': case 'd':
+            set_option(opt);
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-B] [-jstubhwd]\n", argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (is_batch)
+        return batch();
+    return translate();
+}
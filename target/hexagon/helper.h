@@ -1,4 +1,12 @@
 DEF_HELPER_2(raise_exception, void, env, i32)
 DEF_HELPER_2(handle_trap, void, env, i32)
+DEF_HELPER_1(trace_chunk, void, env)
+DEF_HELPER_2(lockstep_tb, void, env, ptr)
+DEF_HELPER_2(snapshot_packet, void, env, i32)
+DEF_HELPER_FLAGS_2(ras_call, TCG_CALL_NO_WG, void, env, ptr)
+DEF_HELPER_FLAGS_2(ras_return, TCG_CALL_NO_WG, ptr, env, i32)
+DEF_HELPER_FLAGS_2(superblock_profile, TCG_CALL_NO_WG, void, env, ptr)
+DEF_HELPER_FLAGS_2(superblock_miss, TCG_CALL_NO_WG, void, env, ptr)
+DEF_HELPER_FLAGS_2(tier_promote, TCG_CALL_NO_WG, void, env, ptr)
 DEF_HELPER_3(divu, i32, env, i32, i32)
 DEF_HELPER_2(mod, i32, i32, i32)
@@ -23,6 +23,8 @@
 #include "qemu/osdep.h"
 #include "cpu.h"
 #include "qemu.h"
+#include "qemu/timer.h"
+#include "tcg.h"
 
 #define HEXAGON_SEMI_HEAP_SIZE (128 * 1024 * 1024)
 
@@ -47,6 +49,8 @@
 #define TARGET_SYS_HEAPINFO    0x016
 #define TARGET_SYS_EXIT        0x018
 #define TARGET_SYS_SYNCCACHE   0x019
+#define TARGET_SYS_ELAPSED     0x030
+#define TARGET_SYS_TICKFREQ    0x031
 #define TARGET_SYS_FTELL       0x100
 #define TARGET_SYS_FSTAT       0x101
 #define TARGET_SYS_STATVFS     0x102
@@ -60,6 +64,9 @@
 #define TARGET_SYS_MKDIR       0x183
 #define TARGET_SYS_RMDIR       0x184
 #define TARGET_SYS_FTRUNC      0x186
+#define TARGET_SYS_EXECSTATS   0x190
+#define TARGET_SYS_SNAPSHOT    0x191
+#define TARGET_SYS_RESTORE     0x192
 
 #define GET_ARG(n) do {                                 \
     if (get_user_u32(arg ## n, args + (n) * 4)) {   \
@@ -469,11 +476,23 @@ target_ulong do_hexagon_semihosting(CPUHexagonState *env)
             return env->gpr[0];
         }
     case TARGET_SYS_EXIT:
-        gdb_exit(env, args);
+        preexit_cleanup(env, args);
         exit(args);
     case TARGET_SYS_SYNCCACHE:
         /* We are not emulating caches, just return */
         return 0;
+    case TARGET_SYS_ELAPSED:
+        {
+            /* Host nanoseconds, as a 64-bit value in the argument block */
+            uint64_t now = get_clock();
+
+            if (SET_ARG(0, (uint32_t)now) || SET_ARG(1, now >> 32)) {
+                return -1;
+            }
+            return 0;
+        }
+    case TARGET_SYS_TICKFREQ:
+        return NANOSECONDS_PER_SECOND;
     case 0xcd:
         /* This syscall is called inside the free function */
         return 0;
@@ -608,6 +627,30 @@ target_ulong do_hexagon_semihosting(CPUHexagonState *env)
         GET_ARG(1);
         ret = ftruncate(arg0, arg1);
         return ret;
+    case TARGET_SYS_EXECSTATS:
+        /*
+         * Packets executed by this vCPU since the first call, as a 64-bit
+         * value, and the number of translated blocks in the code cache.
+         * Only the blocks translated for HEX_TB_FLAG_COUNT_PACKETS count
+         * them, so the first call returns 0.
+         */
+        env->count_packets = true;
+        if (SET_ARG(0, (uint32_t)env->packet_count) ||
+            SET_ARG(1, env->packet_count >> 32) ||
+            SET_ARG(2, tcg_nb_tbs())) {
+            return -1;
+        }
+        return 0;
+    case TARGET_SYS_SNAPSHOT:
+        /*
+         * Snapshot the guest, see snapshot.c.  Like setjmp, this returns 0
+         * once the snapshot is taken, and 1 when a RESTORE rewinds to it.
+         */
+        env->gpr[0] = 0;
+        return hexagon_snapshot_take(env) == 0 ? 0 : -1;
+    case TARGET_SYS_RESTORE:
+        /* Only returns, with -1, if there is no snapshot */
+        return hexagon_snapshot_restore(env) == 0 ? 1 : -1;
     default:
         fprintf(stderr, "qemu: Unsupported SemiHosting SWI 0x%02x\n", nr);
         cpu_dump_state(cs, stderr, fprintf, 0);
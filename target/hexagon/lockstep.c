@@ -0,0 +1,324 @@
+/*
+ * Hexagon lockstep checker
+ *
+ * Copyright (c) 2017-2019 Comsecuris UG (haftungsbeschraenkt)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Lockstep comparison against a reference trace.
+ *
+ * The reference is a flat file of packet records in the format of the
+ * execution trace (see exec-trace.h), as recorded by a known-good run or
+ * converted from a simulator trace with scripts/hexagon-trace.py.  On
+ * entry to every TB, the packets of the previous TB are consumed from the
+ * reference: their addresses are checked against the packets QEMU
+ * translated, their register writes are applied to a shadow register
+ * file, and the shadow registers and the next pc are compared with the
+ * vCPU state.  Comparing per TB keeps the cost to one helper call per
+ * block; running with -singlestep makes every packet a TB and so narrows
+ * a divergence down to a single packet.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/error-report.h"
+#include "qemu/host-utils.h"
+#include "cpu.h"
+#include "exec/exec-all.h"
+#include "exec/helper-proto.h"
+#include "exec/helper-gen.h"
+#include "tcg-op.h"
+#include "exec-trace.h"
+
+/*
+ * Registers compared: all GPRs, and the control registers except the
+ * hardware loop registers (kept in sa/lc), the pc (checked through the
+ * packet addresses) and the cycle, packet and timer counters.
+ */
+#define LOCKSTEP_CR_MASK \
+    (0xffffffffull << 32 & ~(0xfull << 32) & ~(1ull << (32 + CR_PC)) & \
+     ~(0x3full << (32 + CR_UPCYCLELO)) & ~(0x3ull << (32 + CR_UTIMERLO)))
+#define LOCKSTEP_MASK (0xffffffffull | LOCKSTEP_CR_MASK)
+
+/*
+ * Packets translated in a TB.  They are shared by the TBs made of the same
+ * packets and never freed, since the last block executed may have been
+ * invalidated by the time it is checked; retranslating a block thus
+ * allocates nothing.
+ */
+typedef struct HexagonLockstepTB {
+    uint32_t npackets;
+    uint32_t packets[];
+} HexagonLockstepTB;
+
+typedef struct HexagonLockstep {
+    const uint8_t *pos;
+    const uint8_t *end;
+    /* vCPU being checked, the first one to run */
+    CPUHexagonState *env;
+    /* Packets consumed from the reference */
+    uint64_t count;
+    /* Block executed since the last check */
+    const HexagonLockstepTB *pending;
+    /* Shadow registers, valid for the bits set in known */
+    uint32_t regs[64];
+    uint64_t known;
+    bool finished;
+} HexagonLockstep;
+
+bool hexagon_lockstep_enabled;
+static HexagonLockstep lockstep;
+
+/* Set of HexagonLockstepTB, filled at translation time */
+static QemuMutex lockstep_tbs_lock;
+static GHashTable *lockstep_tbs;
+
+static guint lockstep_tb_hash(gconstpointer key)
+{
+    const HexagonLockstepTB *tb = key;
+    guint h = tb->npackets;
+    uint32_t i;
+
+    for (i = 0; i < tb->npackets; i++) {
+        h = h * 31 + tb->packets[i];
+    }
+    return h;
+}
+
+static gboolean lockstep_tb_equal(gconstpointer a, gconstpointer b)
+{
+    const HexagonLockstepTB *ta = a;
+    const HexagonLockstepTB *tb = b;
+
+    return ta->npackets == tb->npackets &&
+           memcmp(ta->packets, tb->packets,
+                  ta->npackets * sizeof(ta->packets[0])) == 0;
+}
+
+void hexagon_lockstep_init(const char *path)
+{
+    HexagonTraceRefHeader *header;
+    struct stat st;
+    void *ref;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        error_report("Could not open reference trace %s: %s", path,
+                     strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    if (st.st_size < sizeof(*header)) {
+        error_report("%s: truncated reference trace", path);
+        exit(EXIT_FAILURE);
+    }
+    ref = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (ref == MAP_FAILED) {
+        error_report("Could not map reference trace %s: %s", path,
+                     strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    close(fd);
+    madvise(ref, st.st_size, MADV_SEQUENTIAL);
+
+    header = ref;
+    if (memcmp(header->magic, HEXAGON_TRACE_REF_MAGIC,
+               sizeof(header->magic)) != 0 ||
+        header->version != HEXAGON_TRACE_VERSION) {
+        error_report("%s: not a version %d Hexagon reference trace", path,
+                     HEXAGON_TRACE_VERSION);
+        exit(EXIT_FAILURE);
+    }
+
+    lockstep.pos = (const uint8_t *)ref + sizeof(*header);
+    lockstep.end = (const uint8_t *)ref + st.st_size;
+    qemu_mutex_init(&lockstep_tbs_lock);
+    lockstep_tbs = g_hash_table_new(lockstep_tb_hash, lockstep_tb_equal);
+    hexagon_lockstep_enabled = true;
+}
+
+static uint32_t lockstep_env_reg(CPUHexagonState *env, int reg)
+{
+    return reg < 32 ? env->gpr[reg] : env->cr[reg - 32];
+}
+
+static const char *lockstep_reg_name(int reg)
+{
+    static char name[8];
+
+    snprintf(name, sizeof(name), "%c%d", reg < 32 ? 'r' : 'c', reg % 32);
+    return name;
+}
+
+static void lockstep_fail(CPUHexagonState *env, const uint8_t *block,
+                          const char *fmt, ...)
+    QEMU_NORETURN GCC_FMT_ATTR(3, 4);
+
+/*
+ * Report the divergence, with the reference packets of the block in which
+ * it was detected, and stop.
+ */
+static void lockstep_fail(CPUHexagonState *env, const uint8_t *block,
+                          const char *fmt, ...)
+{
+    const uint8_t *pos = block;
+    va_list ap;
+
+    fprintf(stderr, "hexagon-lockstep: divergence after %" PRIu64
+            " packets: ", lockstep.count);
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    fprintf(stderr, "\nReference packets of the last block:\n");
+
+    while (pos < lockstep.pos) {
+        const uint32_t *rec = (const uint32_t *)pos;
+        uint64_t mask = rec[1] | (uint64_t)rec[2] << 32;
+        int n = 4, reg;
+
+        fprintf(stderr, "  0x%08x", rec[0]);
+        for (reg = 0; reg < 64; reg++) {
+            if (mask & (1ull << reg)) {
+                fprintf(stderr, " %s=0x%08x", lockstep_reg_name(reg),
+                        rec[n++]);
+            }
+        }
+        fprintf(stderr, "\n");
+        pos += 4 * (n + rec[3]);
+    }
+    if (lockstep.pending != NULL && lockstep.pending->npackets > 1) {
+        fprintf(stderr, "Run with -singlestep to compare every packet.\n");
+    }
+    cpu_dump_state(ENV_GET_CPU(env), stderr, fprintf, 0);
+    exit(EXIT_FAILURE);
+}
+
+/* Apply the next reference packet to the shadow registers */
+static void lockstep_apply(void)
+{
+    const uint32_t *rec = (const uint32_t *)lockstep.pos;
+    uint64_t mask = rec[1] | (uint64_t)rec[2] << 32;
+    uint64_t m = mask;
+    int n = 4;
+
+    while (m) {
+        int reg = ctz64(m);
+
+        lockstep.regs[reg] = rec[n++];
+        m &= m - 1;
+    }
+    lockstep.known |= mask;
+    lockstep.pos += 4 * (n + rec[3]);
+    lockstep.count++;
+}
+
+void helper_lockstep_tb(CPUHexagonState *env, void *tb)
+{
+    const HexagonLockstepTB *pending = lockstep.pending;
+    const uint8_t *block = lockstep.pos;
+    uint64_t diff;
+    uint32_t i;
+
+    if (lockstep.env == NULL) {
+        lockstep.env = env;
+    } else if (lockstep.env != env || lockstep.finished) {
+        return;
+    }
+
+    for (i = 0; pending != NULL && i < pending->npackets; i++) {
+        uint32_t ref_pc;
+
+        if (lockstep.pos >= lockstep.end) {
+            lockstep_fail(env, block, "reference trace ended before packet "
+                          "0x%08x", pending->packets[i]);
+        }
+        ref_pc = *(const uint32_t *)lockstep.pos;
+        if (ref_pc != pending->packets[i]) {
+            lockstep_fail(env, block, "executed packet 0x%08x, reference "
+                          "executed 0x%08x", pending->packets[i], ref_pc);
+        }
+        lockstep_apply();
+    }
+
+    diff = 0;
+    for (i = 0; i < 64; i++) {
+        if ((lockstep.known & LOCKSTEP_MASK & (1ull << i)) &&
+            lockstep_env_reg(env, i) != lockstep.regs[i]) {
+            diff |= 1ull << i;
+        }
+    }
+    if (diff) {
+        int reg = ctz64(diff);
+
+        lockstep_fail(env, block, "%s is 0x%08x, reference has 0x%08x "
+                      "(%d registers differ)", lockstep_reg_name(reg),
+                      lockstep_env_reg(env, reg), lockstep.regs[reg],
+                      ctpop64(diff));
+    }
+
+    if (lockstep.pos >= lockstep.end) {
+        warn_report("hexagon-lockstep: reference trace ended after %" PRIu64
+                    " packets without divergence", lockstep.count);
+        lockstep.finished = true;
+        return;
+    }
+    if (*(const uint32_t *)lockstep.pos != env->cr[CR_PC]) {
+        lockstep_fail(env, block, "next pc is 0x%08x, reference continues "
+                      "at 0x%08x", env->cr[CR_PC],
+                      *(const uint32_t *)lockstep.pos);
+    }
+
+    lockstep.pending = tb;
+}
+
+/* Threads translate in parallel, each with its own TB being generated */
+static __thread TCGOp *lockstep_tb_op;
+
+void hexagon_lockstep_gen_tb_start(void)
+{
+    TCGv_ptr tb = tcg_const_ptr(NULL);
+
+    /* Patched by hexagon_lockstep_gen_tb_end once the packets are known */
+    lockstep_tb_op = tcg_last_op();
+    gen_helper_lockstep_tb(cpu_env, tb);
+    tcg_temp_free_ptr(tb);
+}
+
+void hexagon_lockstep_gen_tb_end(const uint32_t *packets, int npackets)
+{
+    HexagonLockstepTB *tb, *known;
+
+    tb = g_malloc(sizeof(*tb) + npackets * sizeof(tb->packets[0]));
+    tb->npackets = npackets;
+    memcpy(tb->packets, packets, npackets * sizeof(tb->packets[0]));
+
+    qemu_mutex_lock(&lockstep_tbs_lock);
+    known = g_hash_table_lookup(lockstep_tbs, tb);
+    if (known != NULL) {
+        g_free(tb);
+        tb = known;
+    } else {
+        g_hash_table_add(lockstep_tbs, tb);
+    }
+    qemu_mutex_unlock(&lockstep_tbs_lock);
+    tcg_set_insn_param(lockstep_tb_op, 1, (uintptr_t)tb);
+}
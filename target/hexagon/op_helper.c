@@ -30,10 +30,11 @@
 #include "qemu/host-utils.h"
 #include "exec/exec-all.h"
 #include "exec/cpu_ldst.h"
+#include "qemu.h"
 #include "decoder.h"
 
-#define SYSCALL  0
-#define CPU_DUMP 1
+#define SEMIHOST 0
+#define SYSCALL  1
 #define PUTS     2
 #define READN    3
 #define WRITEN   4
@@ -43,6 +44,8 @@
 #define STACK    8
 #define FWRITE   9
 #define EXIT    10
+#define PROFILE 11
+#define CPU_DUMP 12
 
 void helper_raise_exception(CPUHexagonState *env, uint32_t index)
 {
@@ -50,6 +53,7 @@ void helper_raise_exception(CPUHexagonState *env, uint32_t index)
     cs->exception_index = index;
     fprintf(stderr, "Raised exception number %d!", index);
     cpu_dump_state(cs, stderr, fprintf, 0);
+    preexit_cleanup(env, EXIT_SUCCESS);
     exit(EXIT_SUCCESS);
 }
 
@@ -62,10 +66,14 @@ void helper_handle_trap(CPUHexagonState *env, uint32_t index)
         case CPU_DUMP:
             cpu_dump_state(cs, stderr, fprintf, 0);
             break;
-        case SYSCALL:
+        case SEMIHOST:
             cs->exception_index = EXCP_TRAP_INSN;
             cpu_loop_exit(cs);
             break;
+        case SYSCALL:
+            cs->exception_index = EXCP_SYSCALL;
+            cpu_loop_exit(cs);
+            break;
         case PUTS:
             puts((char *)g2h(env->gpr[0]));
             break;
@@ -102,8 +110,12 @@ void helper_handle_trap(CPUHexagonState *env, uint32_t index)
             fclose(out);
             break;
         case EXIT:
+            preexit_cleanup(env, EXIT_SUCCESS);
             exit(EXIT_SUCCESS);
             break;
+        case PROFILE:
+            hexagon_profile_dump();
+            break;
         default:
             assert(false && "Unhandled trap0 argument!");
     }
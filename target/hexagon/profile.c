@@ -0,0 +1,540 @@
+/*
+ * Hexagon execution profiler
+ *
+ * Copyright (c) 2017-2019 Comsecuris UG (haftungsbeschraenkt)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Two modes are available:
+ *
+ * count:  every TB increments a 64-bit counter on entry.  Packet counts
+ *         are derived from the TB counts, since a TB runs all its packets
+ *         unless it raises an exception.  The increments are not atomic,
+ *         so counts of code shared by several guest threads are approximate.
+ *         Blocks are told apart by pc, flags and cflags, so the variants of
+ *         a block specialized on TB flags or translated by another tier
+ *         have counters of their own.  When a block is translated again
+ *         with other packets, e.g. as a superblock, the counts gathered so
+ *         far are credited to the packets of the previous translation.
+ *
+ * sample: a host thread wakes up every few microseconds and records the
+ *         pc_trace of every vCPU that is executing guest code.  Generated
+ *         code is left untouched.  pc_trace only reaches memory at helper
+ *         calls and block exits, so samples are attributed to the block
+ *         containing the sampled address rather than to single packets.
+ *
+ * The report is written at exit, or when the guest executes trap0(#11),
+ * to <prefix>.txt (hottest TBs, packets and functions) and to
+ * <prefix>.folded, one "function;packet weight" line per packet, which
+ * flamegraph.pl reads directly.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/error-report.h"
+#include "qemu/cutils.h"
+#include "qemu/thread.h"
+#include "qemu/rcu.h"
+#include "cpu.h"
+#include "disas/disas.h"
+#include "exec/exec-all.h"
+#include "exec/tb-context.h"
+#include "tcg-op.h"
+#include "profile.h"
+#include "ras.h"
+#include "tier.h"
+
+#define PROFILE_TOP 32
+#define PROFILE_DEFAULT_INTERVAL 1000
+
+typedef enum HexagonProfileMode {
+    HEXAGON_PROFILE_OFF,
+    HEXAGON_PROFILE_COUNT,
+    HEXAGON_PROFILE_SAMPLE,
+} HexagonProfileMode;
+
+typedef struct HexagonProfileKey {
+    uint32_t pc;
+    uint32_t flags;
+    uint32_t cflags;
+} HexagonProfileKey;
+
+typedef struct HexagonProfileTB {
+    /* Incremented by the generated code in counting mode */
+    uint64_t count;
+    /* Counts of the previous translations with other packets */
+    uint64_t retired;
+    HexagonProfileKey key;
+    uint32_t size;
+    /* Start address of every packet of the block */
+    GArray *packets;
+} HexagonProfileTB;
+
+typedef struct HexagonProfileEntry {
+    uint32_t pc;
+    uint32_t end;
+    const char *symbol;
+    uint64_t weight;
+} HexagonProfileEntry;
+
+static HexagonProfileMode profile_mode;
+static unsigned long profile_interval = PROFILE_DEFAULT_INTERVAL;
+static char *profile_prefix;
+
+/* Protects profile_tbs, profile_retired and profile_samples */
+static QemuMutex profile_lock;
+/* HexagonProfileKey -> HexagonProfileTB */
+static GHashTable *profile_tbs;
+/* Packet pc -> count (uint64_t *) of the retired translations */
+static GHashTable *profile_retired;
+/* Guest pc -> number of samples (uint64_t *) */
+static GHashTable *profile_samples;
+static QemuThread profile_thread;
+
+static guint profile_key_hash(gconstpointer key)
+{
+    const HexagonProfileKey *k = key;
+
+    return k->pc ^ (k->flags << 16) ^ k->cflags;
+}
+
+static gboolean profile_key_equal(gconstpointer a, gconstpointer b)
+{
+    const HexagonProfileKey *ka = a;
+    const HexagonProfileKey *kb = b;
+
+    return ka->pc == kb->pc && ka->flags == kb->flags &&
+           ka->cflags == kb->cflags;
+}
+
+static HexagonProfileTB *profile_tb_get(TranslationBlock *tb)
+{
+    HexagonProfileKey key = {
+        .pc = tb->pc,
+        .flags = tb->flags,
+        .cflags = tb_cflags(tb) & ~CF_INVALID,
+    };
+    HexagonProfileTB *p;
+
+    p = g_hash_table_lookup(profile_tbs, &key);
+    if (p == NULL) {
+        p = g_new0(HexagonProfileTB, 1);
+        p->key = key;
+        p->packets = g_array_new(false, false, sizeof(uint32_t));
+        g_hash_table_insert(profile_tbs, &p->key, p);
+    }
+    return p;
+}
+
+void hexagon_profile_tb_start(TranslationBlock *tb)
+{
+    HexagonProfileTB *p;
+    TCGv_ptr counter;
+    TCGv_i64 count;
+
+    if (profile_mode != HEXAGON_PROFILE_COUNT) {
+        return;
+    }
+
+    /*
+     * The counters are never freed, so the address can be baked into the
+     * generated code and survives a retranslation of the same block.
+     */
+    qemu_mutex_lock(&profile_lock);
+    p = profile_tb_get(tb);
+    qemu_mutex_unlock(&profile_lock);
+
+    counter = tcg_const_ptr(&p->count);
+    count = tcg_temp_new_i64();
+    tcg_gen_ld_i64(count, counter, 0);
+    tcg_gen_addi_i64(count, count, 1);
+    tcg_gen_st_i64(count, counter, 0);
+    tcg_temp_free_i64(count);
+    tcg_temp_free_ptr(counter);
+}
+
+static void profile_add(GHashTable *table, uint32_t pc, uint64_t weight)
+{
+    uint64_t *value = g_hash_table_lookup(table, GUINT_TO_POINTER(pc));
+
+    if (value == NULL) {
+        value = g_new0(uint64_t, 1);
+        g_hash_table_insert(table, GUINT_TO_POINTER(pc), value);
+    }
+    *value += weight;
+}
+
+void hexagon_profile_tb_end(TranslationBlock *tb, const uint32_t *packets,
+                            int npackets)
+{
+    HexagonProfileTB *p;
+    guint i;
+
+    if (profile_mode == HEXAGON_PROFILE_OFF) {
+        return;
+    }
+
+    qemu_mutex_lock(&profile_lock);
+    p = profile_tb_get(tb);
+    if (p->count != 0 && (p->packets->len != npackets ||
+                          memcmp(p->packets->data, packets,
+                                 npackets * sizeof(uint32_t)) != 0)) {
+        /* The block now runs other packets, see the top of the file */
+        for (i = 0; i < p->packets->len; i++) {
+            profile_add(profile_retired,
+                        g_array_index(p->packets, uint32_t, i), p->count);
+        }
+        p->retired += p->count;
+        p->count = 0;
+    }
+    p->size = tb->size;
+    g_array_set_size(p->packets, 0);
+    g_array_append_vals(p->packets, packets, npackets);
+    qemu_mutex_unlock(&profile_lock);
+}
+
+static void *profile_sampler(void *opaque)
+{
+    rcu_register_thread();
+
+    for (;;) {
+        CPUState *cs;
+
+        g_usleep(profile_interval);
+
+        rcu_read_lock();
+        qemu_mutex_lock(&profile_lock);
+        CPU_FOREACH(cs) {
+            CPUHexagonState *env = cs->env_ptr;
+
+            /* Time spent in host system calls is not guest code */
+            if (atomic_read(&cs->running)) {
+                profile_add(profile_samples, atomic_read(&env->pc_trace), 1);
+            }
+        }
+        qemu_mutex_unlock(&profile_lock);
+        rcu_read_unlock();
+    }
+
+    return NULL;
+}
+
+static const char *profile_symbol(uint32_t pc)
+{
+    const char *symbol = lookup_symbol(pc);
+
+    return symbol[0] != '\0' ? symbol : "[unknown]";
+}
+
+static gint profile_entry_cmp(gconstpointer a, gconstpointer b)
+{
+    const HexagonProfileEntry *ea = a;
+    const HexagonProfileEntry *eb = b;
+
+    if (ea->weight != eb->weight) {
+        return ea->weight < eb->weight ? 1 : -1;
+    }
+    return ea->pc < eb->pc ? -1 : ea->pc > eb->pc;
+}
+
+static gint profile_tb_pc_cmp(gconstpointer a, gconstpointer b)
+{
+    const HexagonProfileTB *ta = *(HexagonProfileTB * const *)a;
+    const HexagonProfileTB *tb = *(HexagonProfileTB * const *)b;
+
+    return ta->key.pc < tb->key.pc ? -1 : ta->key.pc > tb->key.pc;
+}
+
+/*
+ * Return the index of the last block starting at or before @pc if it also
+ * covers @pc, -1 otherwise.
+ */
+static int profile_tb_find(GPtrArray *by_pc, uint32_t pc)
+{
+    HexagonProfileTB *p;
+    guint lo = 0, hi = by_pc->len;
+
+    while (lo < hi) {
+        guint mid = lo + (hi - lo) / 2;
+
+        p = g_ptr_array_index(by_pc, mid);
+        if (p->key.pc <= pc) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo == 0) {
+        return -1;
+    }
+    p = g_ptr_array_index(by_pc, lo - 1);
+    return pc - p->key.pc < p->size ? lo - 1 : -1;
+}
+
+static void profile_print_top(FILE *f, const char *title, GArray *entries,
+                              uint64_t total, const char *unit,
+                              bool show_address)
+{
+    guint i;
+
+    g_array_sort(entries, profile_entry_cmp);
+    fprintf(f, "\n# %s\n# %16s %7s  %-21s  %s\n", title, unit, "%",
+            show_address ? "address" : "", "symbol");
+    for (i = 0; i < entries->len && i < PROFILE_TOP; i++) {
+        HexagonProfileEntry *e = &g_array_index(entries, HexagonProfileEntry,
+                                                i);
+        char range[32];
+
+        if (e->weight == 0) {
+            break;
+        }
+        if (!show_address) {
+            range[0] = '\0';
+        } else if (e->end != e->pc) {
+            snprintf(range, sizeof(range), "0x%08x-0x%08x", e->pc, e->end);
+        } else {
+            snprintf(range, sizeof(range), "0x%08x", e->pc);
+        }
+        fprintf(f, "  %16" PRIu64 " %6.2f%%  %-21s  %s\n", e->weight,
+                total ? 100.0 * e->weight / total : 0.0, range, e->symbol);
+    }
+}
+
+void hexagon_profile_dump(void)
+{
+    GArray *tbs, *packets, *functions;
+    GHashTable *hits, *by_symbol;
+    GPtrArray *by_pc;
+    GHashTableIter iter;
+    gpointer key, value;
+    uint64_t total_tbs = 0, total_hits = 0;
+    uint64_t ras_hits, ras_lookups, ras_misses;
+    size_t jc_hits = 0, jc_misses = 0, jc_conflicts = 0;
+    CPUState *cs;
+    const char *unit;
+    char *name;
+    FILE *report, *folded;
+    guint i, j;
+
+    if (profile_mode == HEXAGON_PROFILE_OFF) {
+        return;
+    }
+
+    qemu_mutex_lock(&profile_lock);
+
+    tbs = g_array_new(false, false, sizeof(HexagonProfileEntry));
+    hits = g_hash_table_new_full(NULL, NULL, NULL, g_free);
+    by_pc = g_ptr_array_new();
+
+    g_hash_table_iter_init(&iter, profile_tbs);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        g_ptr_array_add(by_pc, value);
+    }
+    g_ptr_array_sort(by_pc, profile_tb_pc_cmp);
+
+    for (i = 0; i < by_pc->len; i++) {
+        HexagonProfileTB *p = g_ptr_array_index(by_pc, i);
+        HexagonProfileEntry e = {
+            .pc = p->key.pc,
+            .end = p->key.pc + p->size,
+            .symbol = profile_symbol(p->key.pc),
+            .weight = p->count + p->retired,
+        };
+
+        g_array_append_val(tbs, e);
+    }
+
+    if (profile_mode == HEXAGON_PROFILE_COUNT) {
+        unit = "count";
+        for (i = 0; i < by_pc->len; i++) {
+            HexagonProfileTB *p = g_ptr_array_index(by_pc, i);
+
+            total_tbs += p->count + p->retired;
+            for (j = 0; j < p->packets->len; j++) {
+                profile_add(hits, g_array_index(p->packets, uint32_t, j),
+                            p->count);
+            }
+        }
+        g_hash_table_iter_init(&iter, profile_retired);
+        while (g_hash_table_iter_next(&iter, &key, &value)) {
+            profile_add(hits, GPOINTER_TO_UINT(key), *(uint64_t *)value);
+        }
+    } else {
+        unit = "samples";
+        g_hash_table_iter_init(&iter, profile_samples);
+        while (g_hash_table_iter_next(&iter, &key, &value)) {
+            uint32_t pc = GPOINTER_TO_UINT(key);
+            int index = profile_tb_find(by_pc, pc);
+
+            /* tbs is in the same order as by_pc */
+            profile_add(hits, pc, *(uint64_t *)value);
+            if (index >= 0) {
+                g_array_index(tbs, HexagonProfileEntry, index).weight +=
+                    *(uint64_t *)value;
+            }
+            total_tbs += *(uint64_t *)value;
+        }
+    }
+
+    qemu_mutex_unlock(&profile_lock);
+
+    packets = g_array_new(false, false, sizeof(HexagonProfileEntry));
+    functions = g_array_new(false, false, sizeof(HexagonProfileEntry));
+    by_symbol = g_hash_table_new(g_str_hash, g_str_equal);
+
+    g_hash_table_iter_init(&iter, hits);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        HexagonProfileEntry e = {
+            .pc = GPOINTER_TO_UINT(key),
+            .end = GPOINTER_TO_UINT(key),
+            .symbol = profile_symbol(GPOINTER_TO_UINT(key)),
+            .weight = *(uint64_t *)value,
+        };
+        gpointer index;
+
+        g_array_append_val(packets, e);
+        total_hits += e.weight;
+
+        if (g_hash_table_lookup_extended(by_symbol, e.symbol, NULL, &index)) {
+            g_array_index(functions, HexagonProfileEntry,
+                          GPOINTER_TO_UINT(index)).weight += e.weight;
+        } else {
+            g_hash_table_insert(by_symbol, (gpointer)e.symbol,
+                                GUINT_TO_POINTER(functions->len));
+            g_array_append_val(functions, e);
+        }
+    }
+
+    name = g_strdup_printf("%s.txt", profile_prefix);
+    report = fopen(name, "w");
+    if (report == NULL) {
+        error_report("Could not open profile report %s: %s", name,
+                     strerror(errno));
+    } else {
+        fprintf(report, "# Hexagon %s profile: %" PRIu64 " block %s, %"
+                PRIu64 " packet %s\n", unit, total_tbs, unit, total_hits,
+                unit);
+        hexagon_ras_stats(&ras_hits, &ras_lookups, &ras_misses);
+        fprintf(report, "# Return address stack: %" PRIu64 " hits, %"
+                PRIu64 " predicted but looked up, %" PRIu64 " misses\n",
+                ras_hits, ras_lookups, ras_misses);
+        if (hexagon_tier_threshold) {
+            fprintf(report, "# Tiered translation: %" PRIu64
+                    " blocks optimized\n", hexagon_tier_stats());
+        }
+        fprintf(report, "# Code cache: %u flushes, %u region evictions, %zu"
+                " blocks evicted, %zu translated again\n",
+                atomic_read(&tb_ctx.tb_flush_count),
+                atomic_read(&tb_ctx.tb_evict_count),
+                atomic_read(&tb_ctx.tb_evicted_count),
+                atomic_read(&tb_ctx.tb_retranslate_count));
+        rcu_read_lock();
+        CPU_FOREACH(cs) {
+            jc_hits += atomic_read(&cs->tb_jmp_cache_hits);
+            jc_misses += atomic_read(&cs->tb_jmp_cache_misses);
+            jc_conflicts += atomic_read(&cs->tb_jmp_cache_conflicts);
+        }
+        rcu_read_unlock();
+        fprintf(report, "# Jump cache: %zu hits, %zu misses, %zu conflicts\n",
+                jc_hits, jc_misses, jc_conflicts);
+        profile_print_top(report, "Hottest translation blocks", tbs,
+                          total_tbs, unit, true);
+        profile_print_top(report,
+                          profile_mode == HEXAGON_PROFILE_COUNT ?
+                          "Hottest packets" : "Hottest sampled addresses",
+                          packets, total_hits, unit, true);
+        profile_print_top(report, "Hottest functions", functions, total_hits,
+                          unit, false);
+        fclose(report);
+    }
+    g_free(name);
+
+    name = g_strdup_printf("%s.folded", profile_prefix);
+    folded = fopen(name, "w");
+    if (folded == NULL) {
+        error_report("Could not open collapsed-stack file %s: %s", name,
+                     strerror(errno));
+    } else {
+        for (i = 0; i < packets->len; i++) {
+            HexagonProfileEntry *e = &g_array_index(packets,
+                                                    HexagonProfileEntry, i);
+
+            fprintf(folded, "%s;0x%08x %" PRIu64 "\n", e->symbol, e->pc,
+                    e->weight);
+        }
+        fclose(folded);
+    }
+    g_free(name);
+
+    g_hash_table_destroy(by_symbol);
+    g_hash_table_destroy(hits);
+    g_ptr_array_free(by_pc, true);
+    g_array_free(functions, true);
+    g_array_free(packets, true);
+    g_array_free(tbs, true);
+}
+
+void hexagon_profile_init(const char *opts)
+{
+    char **options = g_strsplit(opts, ",", -1);
+    char **opt;
+    const char *value;
+
+    for (opt = options; *opt != NULL; opt++) {
+        if (strcmp(*opt, "count") == 0) {
+            profile_mode = HEXAGON_PROFILE_COUNT;
+        } else if (strcmp(*opt, "sample") == 0) {
+            profile_mode = HEXAGON_PROFILE_SAMPLE;
+        } else if (strstart(*opt, "sample=", &value)) {
+            profile_mode = HEXAGON_PROFILE_SAMPLE;
+            if (qemu_strtoul(value, NULL, 0, &profile_interval) < 0 ||
+                profile_interval == 0) {
+                error_report("Invalid sampling interval: %s", *opt);
+                exit(EXIT_FAILURE);
+            }
+        } else if (strstart(*opt, "prefix=", &value)) {
+            g_free(profile_prefix);
+            profile_prefix = g_strdup(value);
+        } else {
+            error_report("Invalid profile option: %s", *opt);
+            exit(EXIT_FAILURE);
+        }
+    }
+    g_strfreev(options);
+
+    if (profile_mode == HEXAGON_PROFILE_OFF) {
+        error_report("No profiling mode given, use count or sample");
+        exit(EXIT_FAILURE);
+    }
+    if (profile_prefix == NULL) {
+        profile_prefix = g_strdup_printf("hexagon-profile-%d", getpid());
+    }
+
+    qemu_mutex_init(&profile_lock);
+    profile_tbs = g_hash_table_new(profile_key_hash, profile_key_equal);
+    profile_retired = g_hash_table_new_full(NULL, NULL, NULL, g_free);
+    profile_samples = g_hash_table_new_full(NULL, NULL, NULL, g_free);
+    if (profile_mode == HEXAGON_PROFILE_SAMPLE) {
+        qemu_thread_create(&profile_thread, "hexagon-profile",
+                           profile_sampler, NULL, QEMU_THREAD_DETACHED);
+    }
+}
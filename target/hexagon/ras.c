@@ -0,0 +1,205 @@
+/*
+ * Hexagon return address stack
+ *
+ * Copyright (c) 2017-2019 Comsecuris UG (haftungsbeschraenkt)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Return address stack
+ *
+ * Returns are indirect jumps, so a TB ending with jumpr r31 or
+ * dealloc_return cannot be chained and used to exit to the main loop, which
+ * looks up the next TB in the hash table.  Instead, each call pushes a call
+ * site on a small per-vCPU stack, holding the return address and the TB
+ * found there the first time the call returned.  A return pops the top
+ * site and, when its address is the one being returned to, jumps straight
+ * into the cached TB with goto_ptr, without leaving the generated code.
+ * Mispredicted returns, e.g. after longjmp, fall back to the lookup done by
+ * helper_lookup_tb_ptr.
+ *
+ * Call sites are allocated at translation time, one per return address, and
+ * live as long as the code cache; they are released on the first translation
+ * after a flush, when no TB can refer to them anymore.  Threads translate in
+ * parallel, so the table is only accessed under ras_sites_lock.  The cached
+ * TB is only used if it was translated for the current flags, see
+ * cpu_get_tb_cpu_state(), and if no code region was evicted since, as its
+ * memory may have been reused.
+ */
+
+#include "qemu/osdep.h"
+#include "cpu.h"
+#include "exec/exec-all.h"
+#include "exec/tb-context.h"
+#include "exec/tb-lookup.h"
+#include "exec/helper-proto.h"
+#include "exec/helper-gen.h"
+#include "tcg-op.h"
+#include "ras.h"
+
+typedef struct HexagonRASSite {
+    /* Return address of the call */
+    uint32_t pc;
+    /* TB at the return address, NULL until the first return */
+    TranslationBlock *tb;
+    /* tb_ctx.tb_evict_count when tb was cached */
+    unsigned evict_count;
+} HexagonRASSite;
+
+/* Call sites by return address */
+static QemuMutex ras_sites_lock;
+static GHashTable *ras_sites;
+static unsigned ras_sites_flush_count;
+
+void hexagon_ras_init(void)
+{
+    qemu_mutex_init(&ras_sites_lock);
+}
+
+static void ras_check_flush(CPUHexagonState *env)
+{
+    unsigned flush_count = atomic_read(&tb_ctx.tb_flush_count);
+
+    if (env->ras_flush_count != flush_count) {
+        memset(env->ras, 0, sizeof(env->ras));
+        env->ras_top = 0;
+        env->ras_flush_count = flush_count;
+    }
+}
+
+void HELPER(ras_call)(CPUHexagonState *env, void *ptr)
+{
+    HexagonRASSite *site = ptr;
+
+    /* The call was predicated false */
+    if (env->cr[CR_PC] == site->pc) {
+        return;
+    }
+    ras_check_flush(env);
+    env->ras_top = (env->ras_top + 1) % HEXAGON_RAS_SIZE;
+    env->ras[env->ras_top] = site;
+}
+
+void *HELPER(ras_return)(CPUHexagonState *env, uint32_t npc)
+{
+    CPUState *cs = ENV_GET_CPU(env);
+    HexagonRASSite *site = NULL;
+    TranslationBlock *tb;
+    target_ulong cs_base, pc;
+    uint32_t flags;
+
+    cpu_get_tb_cpu_state(env, &pc, &cs_base, &flags);
+    if (pc != npc) {
+        ras_check_flush(env);
+        site = env->ras[env->ras_top];
+        env->ras[env->ras_top] = NULL;
+        env->ras_top = (env->ras_top + HEXAGON_RAS_SIZE - 1) % HEXAGON_RAS_SIZE;
+        if (site != NULL && site->pc == pc) {
+            tb = atomic_rcu_read(&site->tb);
+            if (tb != NULL &&
+                site->evict_count == atomic_read(&tb_ctx.tb_evict_count) &&
+                tb->flags == flags &&
+                tb->trace_vcpu_dstate == *cs->trace_dstate &&
+                (tb_cflags(tb) & (CF_HASH_MASK | CF_INVALID)) ==
+                curr_cflags()) {
+                env->ras_hits++;
+                return tb->tc.ptr;
+            }
+            /* Predicted, but the TB is not cached yet or stale */
+            env->ras_lookups++;
+        } else {
+            env->ras_misses++;
+            site = NULL;
+        }
+    }
+
+    tb = tb_lookup__cpu_state(cs, &pc, &cs_base, &flags, curr_cflags());
+    if (tb == NULL) {
+        return tcg_ctx->code_gen_epilogue;
+    }
+    if (site != NULL) {
+        site->evict_count = atomic_read(&tb_ctx.tb_evict_count);
+        atomic_rcu_set(&site->tb, tb);
+    }
+    return tb->tc.ptr;
+}
+
+void hexagon_ras_gen_call(uint32_t npc)
+{
+    unsigned flush_count = atomic_read(&tb_ctx.tb_flush_count);
+    HexagonRASSite *site;
+    TCGv_ptr tmp;
+
+    qemu_mutex_lock(&ras_sites_lock);
+    if (ras_sites == NULL || ras_sites_flush_count != flush_count) {
+        if (ras_sites != NULL) {
+            g_hash_table_destroy(ras_sites);
+        }
+        ras_sites = g_hash_table_new_full(NULL, NULL, NULL, g_free);
+        ras_sites_flush_count = flush_count;
+    }
+    /* Calls translated again after an eviction share the site */
+    site = g_hash_table_lookup(ras_sites, GUINT_TO_POINTER(npc));
+    if (site == NULL) {
+        site = g_new0(HexagonRASSite, 1);
+        site->pc = npc;
+        g_hash_table_insert(ras_sites, GUINT_TO_POINTER(npc), site);
+    }
+    qemu_mutex_unlock(&ras_sites_lock);
+
+    tmp = tcg_const_ptr(site);
+    gen_helper_ras_call(cpu_env, tmp);
+    tcg_temp_free_ptr(tmp);
+}
+
+void hexagon_ras_gen_return(uint32_t npc)
+{
+    TCGv_ptr ptr;
+    TCGv_i32 tmp;
+
+    if (!TCG_TARGET_HAS_goto_ptr || qemu_loglevel_mask(CPU_LOG_TB_NOCHAIN)) {
+        tcg_gen_exit_tb(NULL, 0);
+        return;
+    }
+    ptr = tcg_temp_new_ptr();
+    tmp = tcg_const_i32(npc);
+    gen_helper_ras_return(ptr, cpu_env, tmp);
+    tcg_temp_free_i32(tmp);
+    tcg_gen_op1i(INDEX_op_goto_ptr, tcgv_ptr_arg(ptr));
+    tcg_temp_free_ptr(ptr);
+}
+
+void hexagon_ras_stats(uint64_t *hits, uint64_t *lookups, uint64_t *misses)
+{
+    CPUState *cs;
+
+    *hits = 0;
+    *lookups = 0;
+    *misses = 0;
+    CPU_FOREACH(cs) {
+        CPUHexagonState *env = cs->env_ptr;
+
+        *hits += env->ras_hits;
+        *lookups += env->ras_lookups;
+        *misses += env->ras_misses;
+    }
+}
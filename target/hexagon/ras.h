@@ -0,0 +1,50 @@
+/*
+ * Hexagon return address stack
+ *
+ * Copyright (c) 2017-2019 Comsecuris UG (haftungsbeschraenkt)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HEXAGON_RAS_H
+#define HEXAGON_RAS_H
+
+void hexagon_ras_init(void);
+
+/*
+ * Called by the translator at the end of a TB whose last packet is a call,
+ * before leaving the TB, with @npc the return address of the call.
+ */
+void hexagon_ras_gen_call(uint32_t npc);
+
+/*
+ * Leave a TB whose last packet is a return, @npc being the address of the
+ * next packet, where the return goes if its predicate is false.
+ */
+void hexagon_ras_gen_return(uint32_t npc);
+
+/*
+ * Returns over all vCPUs: predicted and run from the cached TB, predicted
+ * but looked up because the cached TB was missing or stale, mispredicted
+ */
+void hexagon_ras_stats(uint64_t *hits, uint64_t *lookups, uint64_t *misses);
+
+#endif
@@ -0,0 +1,586 @@
+/*
+ * Hexagon guest memory snapshots
+ *
+ * Copyright (c) 2017-2019 Comsecuris UG (haftungsbeschraenkt)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * In-process snapshot and restore of the guest, for stateful fuzzing and
+ * regression replay without fork().
+ *
+ * A snapshot saves the guest pages known to the page table of
+ * translate-all.c, as maintained by linux-user/mmap.c, together with the
+ * heap break and the registers of the vCPU.  Pages that were not
+ * populated yet are not copied: restoring them drops them with
+ * MADV_DONTNEED, which brings back zeroes or the file contents.
+ *
+ * A restore only rewrites the pages dirtied since the snapshot.  They are
+ * found through the soft-dirty bits of /proc/self/pagemap, which are
+ * reset through /proc/self/clear_refs after every snapshot and restore;
+ * if the kernel lacks them, the contents are compared instead.  The code
+ * cache stays valid: only the pages written back lose their TBs, by the
+ * same protection change that handles a guest write to code.  Mappings
+ * created since the snapshot are removed, and removed ones come back as
+ * anonymous memory, or as a mapping of the same file for the pristine
+ * pages of file mappings.
+ *
+ * Resetting the soft-dirty bits write-protects every page of the process,
+ * QEMU's own included, which then take a minor fault on their next write:
+ * this cost is paid once per snapshot and per restore.
+ *
+ * Snapshots are taken and restored by the SNAPSHOT and RESTORE semihosting
+ * calls, or when execution reaches the addresses given with
+ * -hexagon-snapshot.  Only single-threaded guests are supported.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/bitmap.h"
+#include "qemu/cutils.h"
+#include "qemu/error-report.h"
+#include "qemu.h"
+#include "exec/exec-all.h"
+#include "exec/helper-proto.h"
+#include "exec/helper-gen.h"
+#include "tcg-op.h"
+#include "snapshot.h"
+
+/* Bits of a /proc/self/pagemap entry */
+#define PM_SOFT_DIRTY (1ull << 55)
+#define PM_SWAP       (1ull << 62)
+#define PM_PRESENT    (1ull << 63)
+
+typedef struct SnapshotRegion {
+    abi_ulong start;
+    abi_ulong end;
+    /* Page flags when the snapshot was taken */
+    int flags;
+    /* Page contents, not filled for the pristine pages */
+    uint8_t *data;
+    /* Pages not populated when the snapshot was taken */
+    unsigned long *pristine;
+} SnapshotRegion;
+
+/* A file mapping of the guest, for its pristine pages */
+typedef struct SnapshotFile {
+    abi_ulong start;
+    abi_ulong end;
+    uint64_t offset;
+    bool shared;
+    char *path;
+} SnapshotFile;
+
+typedef struct SnapshotRange {
+    abi_ulong start;
+    abi_ulong end;
+} SnapshotRange;
+
+typedef struct HexagonSnapshot {
+    bool valid;
+    GArray *regions;
+    GArray *files;
+    uint8_t regs[offsetof(CPUHexagonState, end_reset_fields)];
+    /* Return address stack, see ras.c */
+    struct HexagonRASSite *ras[HEXAGON_RAS_SIZE];
+    uint32_t ras_top;
+    unsigned ras_flush_count;
+    abi_ulong brk;
+    abi_ulong brk_page;
+    abi_ulong mmap_next_start;
+    abi_ulong heap_base;
+    abi_ulong heap_limit;
+} HexagonSnapshot;
+
+bool hexagon_snapshot_enabled;
+static HexagonSnapshot snapshot;
+
+/* Packets at which -hexagon-snapshot takes and restores the snapshot */
+static uint32_t snapshot_take_pc = -1;
+static uint32_t snapshot_restore_pc = -1;
+
+/* Opened if the host and guest page sizes match, -1 otherwise */
+static int pagemap_fd = -1;
+static bool soft_dirty;
+
+void hexagon_snapshot_init(const char *opts)
+{
+    char **options = g_strsplit(opts, ",", -1);
+    char **opt;
+    const char *value;
+    unsigned long addr;
+
+    for (opt = options; *opt != NULL; opt++) {
+        if (strstart(*opt, "take=", &value) &&
+            qemu_strtoul(value, NULL, 0, &addr) == 0) {
+            snapshot_take_pc = addr;
+        } else if (strstart(*opt, "restore=", &value) &&
+                   qemu_strtoul(value, NULL, 0, &addr) == 0) {
+            snapshot_restore_pc = addr;
+        } else {
+            error_report("Invalid snapshot option: %s", *opt);
+            exit(EXIT_FAILURE);
+        }
+    }
+    g_strfreev(options);
+
+    if (snapshot_take_pc == snapshot_restore_pc) {
+        error_report("The snapshot must be taken and restored at different "
+                     "addresses");
+        exit(EXIT_FAILURE);
+    }
+    hexagon_snapshot_enabled = true;
+}
+
+static bool snapshot_clear_refs(void)
+{
+    int fd = open("/proc/self/clear_refs", O_WRONLY);
+    bool ok;
+
+    if (fd < 0) {
+        return false;
+    }
+    ok = write(fd, "4", 1) == 1;
+    close(fd);
+    return ok;
+}
+
+/* Reset the soft-dirty bits, once the guest memory matches the snapshot */
+static void snapshot_clear_dirty(void)
+{
+    if (soft_dirty && !snapshot_clear_refs()) {
+        soft_dirty = false;
+    }
+}
+
+/*
+ * Read the pagemap entries of the guest pages [start, end), or return
+ * NULL if they are not available.
+ */
+static uint64_t *snapshot_pagemap(abi_ulong start, abi_ulong end)
+{
+    size_t npages = (end - start) >> TARGET_PAGE_BITS;
+    uint64_t *entries;
+    off_t offset;
+
+    if (pagemap_fd < 0) {
+        return NULL;
+    }
+    entries = g_new(uint64_t, npages);
+    offset = (uintptr_t)g2h(start) / TARGET_PAGE_SIZE * sizeof(uint64_t);
+    if (pread(pagemap_fd, entries, npages * sizeof(uint64_t), offset) !=
+        npages * sizeof(uint64_t)) {
+        g_free(entries);
+        return NULL;
+    }
+    return entries;
+}
+
+/* Check, on a page of our own, that writes set the soft-dirty bit */
+static void snapshot_probe(void)
+{
+    static bool probed;
+    uint64_t entry;
+    uint8_t *page;
+
+    if (probed) {
+        return;
+    }
+    probed = true;
+
+    if (qemu_real_host_page_size != TARGET_PAGE_SIZE) {
+        return;
+    }
+    pagemap_fd = open("/proc/self/pagemap", O_RDONLY);
+    if (pagemap_fd < 0) {
+        return;
+    }
+
+    page = mmap(NULL, TARGET_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (page == MAP_FAILED) {
+        return;
+    }
+    page[0] = 1;
+    if (snapshot_clear_refs()) {
+        page[0] = 2;
+        if (pread(pagemap_fd, &entry, sizeof(entry),
+                  (uintptr_t)page / TARGET_PAGE_SIZE * sizeof(entry)) ==
+            sizeof(entry)) {
+            soft_dirty = entry & PM_SOFT_DIRTY;
+        }
+    }
+    munmap(page, TARGET_PAGE_SIZE);
+}
+
+/* Guest protection of a page, whatever the write protection of its code */
+static int snapshot_prot(int flags)
+{
+    return (flags & PAGE_READ ? PROT_READ : 0) |
+           (flags & PAGE_WRITE_ORG ? PROT_WRITE : 0) |
+           (flags & PAGE_EXEC ? PROT_EXEC : 0);
+}
+
+static int snapshot_save_region(void *priv, target_ulong start,
+                                target_ulong end, unsigned long flags)
+{
+    size_t npages = (end - start) >> TARGET_PAGE_BITS;
+    uint64_t *pagemap;
+    SnapshotRegion r;
+    size_t i;
+
+    if (!(flags & PAGE_VALID)) {
+        return 0;
+    }
+    pagemap = snapshot_pagemap(start, end);
+    r.start = start;
+    r.end = end;
+    r.flags = flags;
+    r.data = g_malloc(end - start);
+    r.pristine = bitmap_new(npages);
+
+    if (!(flags & PAGE_READ)) {
+        mprotect(g2h(start), end - start, PROT_READ);
+    }
+    for (i = 0; i < npages; i++) {
+        if (pagemap && !(pagemap[i] & (PM_PRESENT | PM_SWAP))) {
+            set_bit(i, r.pristine);
+        } else {
+            memcpy(r.data + i * TARGET_PAGE_SIZE,
+                   g2h(start + i * TARGET_PAGE_SIZE), TARGET_PAGE_SIZE);
+        }
+    }
+    if (!(flags & PAGE_READ)) {
+        mprotect(g2h(start), end - start, flags & PAGE_BITS);
+    }
+
+    g_free(pagemap);
+    g_array_append_val(snapshot.regions, r);
+    return 0;
+}
+
+/*
+ * List the file mappings of the guest, so that their pristine pages can be
+ * mapped again if they are unmapped after the snapshot.
+ */
+static void snapshot_save_files(void)
+{
+    FILE *fp;
+    char *line = NULL;
+    size_t len = 0;
+
+    /* Pages are only known to be pristine through the pagemap */
+    if (pagemap_fd < 0) {
+        return;
+    }
+    fp = fopen("/proc/self/maps", "r");
+    if (fp == NULL) {
+        return;
+    }
+    while (getline(&line, &len, fp) != -1) {
+        int fields, dev_maj, dev_min, inode;
+        uint64_t min, max, offset;
+        char flag_r, flag_w, flag_x, flag_p;
+        char path[512] = "";
+        SnapshotFile f;
+
+        fields = sscanf(line, "%"PRIx64"-%"PRIx64" %c%c%c%c %"PRIx64" %x:%x %d"
+                        " %511s", &min, &max, &flag_r, &flag_w, &flag_x,
+                        &flag_p, &offset, &dev_maj, &dev_min, &inode, path);
+        if (fields != 11 || inode == 0 || path[0] != '/' ||
+            strstr(line, " (deleted)") != NULL ||
+            !h2g_valid(min) || !h2g_valid(max - 1)) {
+            continue;
+        }
+        f.start = h2g(min);
+        f.end = h2g(max - 1) + 1;
+        f.offset = offset;
+        f.shared = flag_p == 's';
+        f.path = g_strdup(path);
+        g_array_append_val(snapshot.files, f);
+    }
+    free(line);
+    fclose(fp);
+}
+
+/* Map again the file that backed the pristine page at addr */
+static bool snapshot_map_file(abi_ulong addr)
+{
+    guint i;
+
+    for (i = 0; i < snapshot.files->len; i++) {
+        SnapshotFile *f = &g_array_index(snapshot.files, SnapshotFile, i);
+        int prot = PROT_READ | PROT_WRITE;
+        abi_long ret;
+        int fd = -1;
+
+        if (addr < f->start || addr >= f->end) {
+            continue;
+        }
+        if (f->shared) {
+            /* Writable shared mappings need the file opened for writing */
+            fd = open(f->path, O_RDWR);
+        }
+        if (fd < 0) {
+            fd = open(f->path, O_RDONLY);
+            prot = f->shared ? PROT_READ : prot;
+        }
+        if (fd < 0) {
+            return false;
+        }
+        ret = target_mmap(addr, TARGET_PAGE_SIZE, prot,
+                          (f->shared ? MAP_SHARED : MAP_PRIVATE) | MAP_FIXED,
+                          fd, f->offset + (addr - f->start));
+        close(fd);
+        return ret != -1;
+    }
+    return false;
+}
+
+static void snapshot_free(void)
+{
+    guint i;
+
+    if (snapshot.regions == NULL) {
+        return;
+    }
+    for (i = 0; i < snapshot.files->len; i++) {
+        g_free(g_array_index(snapshot.files, SnapshotFile, i).path);
+    }
+    g_array_free(snapshot.files, true);
+    snapshot.files = NULL;
+    for (i = 0; i < snapshot.regions->len; i++) {
+        SnapshotRegion *r = &g_array_index(snapshot.regions,
+                                           SnapshotRegion, i);
+        g_free(r->data);
+        g_free(r->pristine);
+    }
+    g_array_free(snapshot.regions, true);
+    snapshot.regions = NULL;
+    snapshot.valid = false;
+}
+
+int hexagon_snapshot_take(CPUHexagonState *env)
+{
+    CPUState *cs = ENV_GET_CPU(env);
+    TaskState *ts = cs->opaque;
+
+    if (CPU_NEXT(first_cpu) != NULL) {
+        error_report("hexagon-snapshot: multi-threaded guests are not "
+                     "supported");
+        return -1;
+    }
+    snapshot_probe();
+    snapshot_free();
+
+    snapshot.regions = g_array_new(false, false, sizeof(SnapshotRegion));
+    snapshot.files = g_array_new(false, false, sizeof(SnapshotFile));
+    mmap_lock();
+    snapshot_save_files();
+    walk_memory_regions(NULL, snapshot_save_region);
+    mmap_unlock();
+
+    memcpy(snapshot.regs, env, sizeof(snapshot.regs));
+    memcpy(snapshot.ras, env->ras, sizeof(snapshot.ras));
+    snapshot.ras_top = env->ras_top;
+    snapshot.ras_flush_count = env->ras_flush_count;
+    target_get_brk(&snapshot.brk, &snapshot.brk_page);
+    snapshot.mmap_next_start = mmap_next_start;
+    snapshot.heap_base = ts->heap_base;
+    snapshot.heap_limit = ts->heap_limit;
+    snapshot.valid = true;
+
+    snapshot_clear_dirty();
+    return 0;
+}
+
+static int snapshot_list_region(void *priv, target_ulong start,
+                                target_ulong end, unsigned long flags)
+{
+    SnapshotRange range = { start, end };
+
+    if (flags & PAGE_VALID) {
+        g_array_append_val((GArray *)priv, range);
+    }
+    return 0;
+}
+
+/* Unmap the parts of [start, end) that are not in the snapshot */
+static void snapshot_unmap_new(abi_ulong start, abi_ulong end)
+{
+    abi_ulong addr = start;
+    guint i;
+
+    for (i = 0; i < snapshot.regions->len && addr < end; i++) {
+        SnapshotRegion *r = &g_array_index(snapshot.regions,
+                                           SnapshotRegion, i);
+
+        if (r->end <= addr) {
+            continue;
+        }
+        if (r->start >= end) {
+            break;
+        }
+        if (r->start > addr) {
+            target_munmap(addr, r->start - addr);
+        }
+        addr = r->end;
+    }
+    if (addr < end) {
+        target_munmap(addr, end - addr);
+    }
+}
+
+static bool snapshot_page_dirty(SnapshotRegion *r, uint64_t *pagemap,
+                                size_t i, int flags)
+{
+    if (pagemap && soft_dirty) {
+        return pagemap[i] & PM_SOFT_DIRTY;
+    }
+    if (test_bit(i, r->pristine)) {
+        /* Populated since the snapshot, maybe only by a read */
+        return !pagemap || (pagemap[i] & (PM_PRESENT | PM_SWAP));
+    }
+    return !(flags & PAGE_READ) ||
+           memcmp(g2h(r->start + i * TARGET_PAGE_SIZE),
+                  r->data + i * TARGET_PAGE_SIZE, TARGET_PAGE_SIZE) != 0;
+}
+
+static void snapshot_restore_region(SnapshotRegion *r)
+{
+    uint64_t *pagemap = snapshot_pagemap(r->start, r->end);
+    int prot = snapshot_prot(r->flags);
+    abi_ulong addr;
+    size_t i;
+
+    for (addr = r->start, i = 0; addr < r->end;
+         addr += TARGET_PAGE_SIZE, i++) {
+        int flags = page_get_flags(addr);
+        bool reprotect = snapshot_prot(flags) != prot;
+
+        if (!(flags & PAGE_VALID)) {
+            /* Unmapped since the snapshot */
+            if (!test_bit(i, r->pristine)) {
+                target_mmap(addr, TARGET_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+                memcpy(g2h(addr), r->data + i * TARGET_PAGE_SIZE,
+                       TARGET_PAGE_SIZE);
+            } else if (!snapshot_map_file(addr)) {
+                target_mmap(addr, TARGET_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+            }
+            reprotect = true;
+        } else if (snapshot_page_dirty(r, pagemap, i, flags)) {
+            if (!(flags & PAGE_WRITE)) {
+                /* Drops the TBs of the page, as a guest write would */
+                target_mprotect(addr, TARGET_PAGE_SIZE,
+                                snapshot_prot(flags) | PROT_READ | PROT_WRITE);
+                reprotect = true;
+            }
+            if (test_bit(i, r->pristine)) {
+                madvise(g2h(addr), TARGET_PAGE_SIZE, MADV_DONTNEED);
+            } else {
+                memcpy(g2h(addr), r->data + i * TARGET_PAGE_SIZE,
+                       TARGET_PAGE_SIZE);
+            }
+        }
+        if (reprotect) {
+            target_mprotect(addr, TARGET_PAGE_SIZE, prot);
+        }
+    }
+    g_free(pagemap);
+}
+
+int hexagon_snapshot_restore(CPUHexagonState *env)
+{
+    CPUState *cs = ENV_GET_CPU(env);
+    TaskState *ts = cs->opaque;
+    uint64_t packet_count = env->packet_count;
+    GArray *current;
+    guint i;
+
+    if (!snapshot.valid) {
+        return -1;
+    }
+
+    mmap_lock();
+    current = g_array_new(false, false, sizeof(SnapshotRange));
+    walk_memory_regions(current, snapshot_list_region);
+    for (i = 0; i < current->len; i++) {
+        SnapshotRange *range = &g_array_index(current, SnapshotRange, i);
+        snapshot_unmap_new(range->start, range->end);
+    }
+    g_array_free(current, true);
+
+    for (i = 0; i < snapshot.regions->len; i++) {
+        snapshot_restore_region(&g_array_index(snapshot.regions,
+                                               SnapshotRegion, i));
+    }
+    mmap_unlock();
+
+    memcpy(env, snapshot.regs, sizeof(snapshot.regs));
+    /* The packet count keeps running, for the benchmarks */
+    env->packet_count = packet_count;
+    /*
+     * The call sites saved are still valid, unless the code cache was
+     * flushed since, in which case the flush count makes the stack be
+     * dropped before it is used.  The trace and the statistics keep
+     * running; only the memory addresses of the current packet go.
+     */
+    memcpy(env->ras, snapshot.ras, sizeof(env->ras));
+    env->ras_top = snapshot.ras_top;
+    env->ras_flush_count = snapshot.ras_flush_count;
+    memset(env->trace_mem, 0, sizeof(env->trace_mem));
+    target_restore_brk(snapshot.brk, snapshot.brk_page);
+    mmap_next_start = snapshot.mmap_next_start;
+    ts->heap_base = snapshot.heap_base;
+    ts->heap_limit = snapshot.heap_limit;
+
+    snapshot_clear_dirty();
+    return 0;
+}
+
+void HELPER(snapshot_packet)(CPUHexagonState *env, uint32_t pc)
+{
+    CPUState *cs = ENV_GET_CPU(env);
+
+    if (pc == snapshot_take_pc && !snapshot.valid) {
+        env->cr[CR_PC] = pc;
+        hexagon_snapshot_take(env);
+    } else if (pc == snapshot_restore_pc && snapshot.valid) {
+        /* Mappings can only change outside of the TB, in cpu_loop */
+        env->cr[CR_PC] = pc;
+        cs->exception_index = EXCP_SNAPSHOT;
+        cpu_loop_exit(cs);
+    }
+}
+
+void hexagon_snapshot_gen_packet(uint32_t pc)
+{
+    TCGv_i32 tmp;
+
+    if (pc != snapshot_take_pc && pc != snapshot_restore_pc) {
+        return;
+    }
+    tmp = tcg_const_i32(pc);
+    gen_helper_snapshot_packet(cpu_env, tmp);
+    tcg_temp_free_i32(tmp);
+}
@@ -0,0 +1,275 @@
+/*
+ * Hexagon superblock formation
+ *
+ * Copyright (c) 2017-2019 Comsecuris UG (haftungsbeschraenkt)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Superblock formation
+ *
+ * A block normally ends at the first packet writing the PC.  With
+ * -hexagon-superblock, the blocks ending with a single direct branch count
+ * which way it goes.  Once one side dominates, the block holding the branch
+ * is invalidated and retranslated: the translation now continues on the
+ * likely side, behind a side exit taken when the PC is not the predicted
+ * one.  Superblocks thus span several basic blocks and run the hot path of
+ * e.g. a parser state machine without going back to the main loop.
+ *
+ * Each branch starts with its :t or :nt static hint as a head start for the
+ * hinted side.  A superblock counts the hits of its predictions, its side
+ * exits the misses, and when a prediction goes wrong too often the branch
+ * is profiled again, up to a few times before it is left unpredicted.
+ *
+ * Superblocks are made of the guest code between their first and last
+ * packets, which must fit in two pages as for any TB, so they only follow
+ * forward branches.
+ */
+
+#include "qemu/osdep.h"
+#include "cpu.h"
+#include "decoder.h"
+#include "exec/exec-all.h"
+#include "exec/helper-proto.h"
+#include "exec/helper-gen.h"
+#include "tcg-op.h"
+#include "superblock.h"
+#include "warmcache.h"
+
+/* Executions of a branch before deciding whether it is biased */
+#define SB_PROFILE_COUNT 64
+/* Head start of the side given by the static hint */
+#define SB_HINT_WEIGHT 8
+/* Predictions over which the hit rate of a superblock is measured */
+#define SB_WINDOW 1024
+/* Misses before a prediction can be dropped */
+#define SB_MIN_MISSES 16
+/* Times a branch is profiled again before being left unpredicted */
+#define SB_MAX_RETRANSLATIONS 4
+
+enum {
+    SB_PROFILING,
+    SB_TAKEN,
+    SB_NOT_TAKEN,
+    SB_UNBIASED,
+};
+
+typedef struct HexagonBranch {
+    /* Packet holding the branch, its target and the next packet */
+    uint32_t pc;
+    uint32_t target;
+    uint32_t npc;
+    int state;
+    int retranslations;
+    /* While profiling */
+    uint32_t taken;
+    uint32_t not_taken;
+    /* While predicted, the hits being counted by the generated code */
+    uint64_t hits;
+    uint64_t misses;
+} HexagonBranch;
+
+bool hexagon_superblock_enabled;
+
+/*
+ * Indexed by the address of the packet holding the branch.  The entries are
+ * never freed, so they can be referred to by the generated code, and are
+ * only created at translation time, under branches_lock.
+ */
+static QemuMutex branches_lock;
+static GHashTable *branches;
+
+void hexagon_superblock_init(void)
+{
+    qemu_mutex_init(&branches_lock);
+    branches = g_hash_table_new(NULL, NULL);
+    hexagon_superblock_enabled = true;
+}
+
+static void superblock_profile(HexagonBranch *b, bool hint)
+{
+    b->state = SB_PROFILING;
+    b->taken = hint ? SB_HINT_WEIGHT : 0;
+    b->not_taken = hint ? 0 : SB_HINT_WEIGHT;
+    b->hits = 0;
+    b->misses = 0;
+}
+
+static HexagonBranch *superblock_branch_get(uint32_t pc, uint32_t target,
+                                            uint32_t npc, bool hint)
+{
+    HexagonBranch *b;
+
+    qemu_mutex_lock(&branches_lock);
+    b = g_hash_table_lookup(branches, GUINT_TO_POINTER(pc));
+    if (b == NULL) {
+        b = g_new0(HexagonBranch, 1);
+        b->pc = pc;
+        g_hash_table_insert(branches, GUINT_TO_POINTER(pc), b);
+    } else if (b->target == target && b->npc == npc) {
+        qemu_mutex_unlock(&branches_lock);
+        return b;
+    }
+    /* New branch, or the code was modified */
+    b->target = target;
+    b->npc = npc;
+    b->retranslations = 0;
+    superblock_profile(b, hint);
+    /* Known from a previous run, see warmcache.c */
+    if (hexagon_warm_cache_enabled) {
+        hexagon_warm_cache_branch(pc, target, npc, &b->state);
+    }
+    qemu_mutex_unlock(&branches_lock);
+    return b;
+}
+
+/* Retranslate the blocks holding the branch with its new prediction */
+static void superblock_retranslate(HexagonBranch *b)
+{
+    /* Only called from helpers, outside of tb_gen_code: mmap_lock cannot
+       be taken under its read side */
+    assert(!have_mmap_read_lock());
+    mmap_lock();
+    tb_invalidate_phys_range(b->pc, b->pc + 4);
+    mmap_unlock();
+}
+
+void HELPER(superblock_profile)(CPUHexagonState *env, void *ptr)
+{
+    HexagonBranch *b = ptr;
+    uint32_t pc = env->cr[CR_PC];
+    uint32_t total;
+
+    if (b->state != SB_PROFILING) {
+        return;
+    }
+    if (pc == b->target) {
+        b->taken++;
+    } else if (pc == b->npc) {
+        b->not_taken++;
+    } else {
+        return;
+    }
+
+    total = b->taken + b->not_taken;
+    if (total < SB_PROFILE_COUNT) {
+        return;
+    }
+    if (b->taken * 8 >= total * 7) {
+        b->state = SB_TAKEN;
+    } else if (b->not_taken * 8 >= total * 7) {
+        b->state = SB_NOT_TAKEN;
+    } else {
+        b->state = SB_UNBIASED;
+    }
+    if (hexagon_warm_cache_enabled) {
+        hexagon_warm_cache_set_branch(b->pc, b->target, b->npc, b->state);
+    }
+    /* Even if unbiased, to drop the call to this helper */
+    superblock_retranslate(b);
+}
+
+void HELPER(superblock_miss)(CPUHexagonState *env, void *ptr)
+{
+    HexagonBranch *b = ptr;
+
+    if (b->state != SB_TAKEN && b->state != SB_NOT_TAKEN) {
+        return;
+    }
+    b->misses++;
+    if (b->misses < SB_MIN_MISSES || b->misses * 8 < b->hits + b->misses) {
+        if (b->hits + b->misses > SB_WINDOW) {
+            b->hits /= 2;
+            b->misses /= 2;
+        }
+        return;
+    }
+
+    /* Mispredicted more than once in 8 times, profile again */
+    if (++b->retranslations < SB_MAX_RETRANSLATIONS) {
+        superblock_profile(b, b->state == SB_TAKEN);
+        if (hexagon_warm_cache_enabled) {
+            hexagon_warm_cache_forget_branch(b->pc);
+        }
+    } else {
+        b->state = SB_UNBIASED;
+        if (hexagon_warm_cache_enabled) {
+            hexagon_warm_cache_set_branch(b->pc, b->target, b->npc,
+                                          b->state);
+        }
+    }
+    superblock_retranslate(b);
+}
+
+uint32_t hexagon_superblock_gen_branch(uint32_t pc, uint32_t target,
+                                       uint32_t npc, bool hint,
+                                       uint32_t limit, int npackets,
+                                       HexagonSideExit *exit)
+{
+    HexagonBranch *b = superblock_branch_get(pc, target, npc, hint);
+    uint32_t next;
+    TCGv_ptr ptr;
+    TCGv_i64 hits;
+
+    switch (b->state) {
+    case SB_PROFILING:
+        ptr = tcg_const_ptr(b);
+        gen_helper_superblock_profile(cpu_env, ptr);
+        tcg_temp_free_ptr(ptr);
+        return 0;
+    case SB_TAKEN:
+        next = target;
+        break;
+    case SB_NOT_TAKEN:
+        next = npc;
+        break;
+    default:
+        return 0;
+    }
+    if (next <= pc || next > limit - SB_MAX_PACKET_SIZE) {
+        return 0;
+    }
+
+    exit->label = gen_new_label();
+    exit->branch = b;
+    exit->npackets = npackets;
+    tcg_gen_brcondi_i32(TCG_COND_NE, CR[CR_PC], next, exit->label);
+
+    ptr = tcg_const_ptr(&b->hits);
+    hits = tcg_temp_new_i64();
+    tcg_gen_ld_i64(hits, ptr, 0);
+    tcg_gen_addi_i64(hits, hits, 1);
+    tcg_gen_st_i64(hits, ptr, 0);
+    tcg_temp_free_i64(hits);
+    tcg_temp_free_ptr(ptr);
+    return next;
+}
+
+void hexagon_superblock_gen_side_exit(const HexagonSideExit *exit)
+{
+    TCGv_ptr ptr;
+
+    gen_set_label(exit->label);
+    ptr = tcg_const_ptr(exit->branch);
+    gen_helper_superblock_miss(cpu_env, ptr);
+    tcg_temp_free_ptr(ptr);
+}
@@ -0,0 +1,61 @@
+/*
+ * Hexagon superblock formation
+ *
+ * Copyright (c) 2017-2019 Comsecuris UG (haftungsbeschraenkt)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HEXAGON_SUPERBLOCK_H
+#define HEXAGON_SUPERBLOCK_H
+
+#include "tcg.h"
+
+extern bool hexagon_superblock_enabled;
+
+/* Largest packet, which must fit before the end of a superblock */
+#define SB_MAX_PACKET_SIZE 16
+
+/* Where a superblock leaves its predicted path */
+typedef struct HexagonSideExit {
+    TCGLabel *label;
+    struct HexagonBranch *branch;
+    /* Packets of the superblock executed when taking the exit */
+    int npackets;
+} HexagonSideExit;
+
+/*
+ * Called at the end of the packet at @pc, whose only branch is a direct one
+ * to @target, with @npc the next packet and @hint the :t static hint.
+ * Returns the packet the block continues with when the branch is biased
+ * enough, filling @exit with the side exit to emit once the block is done,
+ * or 0 when the block ends here.  Only packets after @pc and before @limit
+ * can be followed, @npackets being those of the block so far.
+ */
+uint32_t hexagon_superblock_gen_branch(uint32_t pc, uint32_t target,
+                                       uint32_t npc, bool hint,
+                                       uint32_t limit, int npackets,
+                                       HexagonSideExit *exit);
+
+/* Emit the start of @exit, before leaving the block */
+void hexagon_superblock_gen_side_exit(const HexagonSideExit *exit);
+
+#endif
@@ -0,0 +1,154 @@
+/*
+ * Hexagon tiered translation
+ *
+ * Copyright (c) 2017-2019 Comsecuris UG (haftungsbeschraenkt)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Tiered translation
+ *
+ * Most of the code of a large guest image runs only a few times, for
+ * instance the initialization code, or the parsers touched by one fuzzing
+ * input, and spends more time being translated than being executed.  With
+ * -hexagon-tier, a block is first translated quickly: the TCG optimizer is
+ * skipped and no superblock is formed.  Such a block counts down its
+ * executions, and once it is hot it is invalidated, so that it is
+ * translated again, with every optimization, the next time it is reached.
+ *
+ * The quick tier only saves the optimizer pass, and pays for the countdown
+ * in every execution, then for the promotion helper, mmap_lock and the
+ * invalidation of the block.  Whether this wins has not been measured, so
+ * it stays off unless -hexagon-tier is given; "make bench-tier" in
+ * tests/tcg/hexagon compares both.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/cutils.h"
+#include "qemu/error-report.h"
+#include "cpu.h"
+#include "exec/exec-all.h"
+#include "exec/helper-proto.h"
+#include "exec/helper-gen.h"
+#include "tcg-op.h"
+#include "tier.h"
+#include "warmcache.h"
+
+typedef struct HexagonTierBlock {
+    uint32_t pc;
+    /* Executions left before the block is hot, counted by generated code */
+    int32_t count;
+    bool hot;
+} HexagonTierBlock;
+
+int hexagon_tier_threshold;
+
+/*
+ * Indexed by the address of the first packet of the block.  The entries
+ * are never freed, so they can be referred to by the generated code, and
+ * are only created at translation time, under blocks_lock.
+ */
+static QemuMutex blocks_lock;
+static GHashTable *blocks;
+static uint64_t tier_promoted;
+
+void hexagon_tier_init(const char *arg)
+{
+    unsigned long threshold;
+
+    if (qemu_strtoul(arg, NULL, 0, &threshold) < 0 ||
+        threshold == 0 || threshold > INT32_MAX) {
+        error_report("Invalid tier threshold: %s", arg);
+        exit(EXIT_FAILURE);
+    }
+    qemu_mutex_init(&blocks_lock);
+    blocks = g_hash_table_new(NULL, NULL);
+    hexagon_tier_threshold = threshold;
+}
+
+bool hexagon_tier_gen_tb_start(TranslationBlock *tb)
+{
+    HexagonTierBlock *b;
+    TCGLabel *cold;
+    TCGv_ptr ptr;
+    TCGv_i32 count;
+
+    qemu_mutex_lock(&blocks_lock);
+    b = g_hash_table_lookup(blocks, GUINT_TO_POINTER(tb->pc));
+    if (b == NULL) {
+        b = g_new0(HexagonTierBlock, 1);
+        b->pc = tb->pc;
+        b->count = hexagon_tier_threshold;
+        /* Hot in a previous run, see warmcache.c */
+        b->hot = hexagon_warm_cache_enabled && hexagon_warm_cache_hot(tb->pc);
+        g_hash_table_insert(blocks, GUINT_TO_POINTER(tb->pc), b);
+    }
+    qemu_mutex_unlock(&blocks_lock);
+    /* Only set with mmap_lock held, which excludes the translations */
+    if (b->hot) {
+        return false;
+    }
+
+    tb->cflags |= CF_NOOPT;
+
+    cold = gen_new_label();
+    ptr = tcg_const_ptr(&b->count);
+    count = tcg_temp_new_i32();
+    tcg_gen_ld_i32(count, ptr, 0);
+    tcg_gen_subi_i32(count, count, 1);
+    tcg_gen_st_i32(count, ptr, 0);
+    tcg_gen_brcondi_i32(TCG_COND_GT, count, 0, cold);
+    tcg_temp_free_i32(count);
+    tcg_temp_free_ptr(ptr);
+
+    ptr = tcg_const_ptr(b);
+    gen_helper_tier_promote(cpu_env, ptr);
+    tcg_temp_free_ptr(ptr);
+    gen_set_label(cold);
+    return true;
+}
+
+void HELPER(tier_promote)(CPUHexagonState *env, void *ptr)
+{
+    HexagonTierBlock *b = ptr;
+
+    /* Several threads may get there, or the block run again before it
+       is unlinked.  Helpers run outside of tb_gen_code, so the read side
+       of mmap_lock is not held here: it cannot be upgraded to the write
+       side, and taking it under the read side would deadlock. */
+    assert(!have_mmap_read_lock());
+    mmap_lock();
+    if (!b->hot) {
+        b->hot = true;
+        tier_promoted++;
+        if (hexagon_warm_cache_enabled) {
+            hexagon_warm_cache_set_hot(b->pc);
+        }
+        tb_invalidate_phys_range(b->pc, b->pc + 4);
+    }
+    mmap_unlock();
+}
+
+uint64_t hexagon_tier_stats(void)
+{
+    return tier_promoted;
+}
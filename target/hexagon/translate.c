@@ -35,6 +35,12 @@
 #include "exec/cpu_ldst.h"
 #include "exec/helper-gen.h"
 #include "exec/translator.h"
+#include "profile.h"
+#include "exec-trace.h"
+#include "snapshot.h"
+#include "ras.h"
+#include "superblock.h"
+#include "tier.h"
 
 #include "trace-tcg.h"
 #include "exec/log.h"
@@ -46,8 +52,6 @@
     (EXTRACT_FIELD(src, start2, end2) << (end - start + 1)) | \
     (EXTRACT_FIELD(src, start, end))
 
-//#define DUMP_EVERY_INST
-
 TCGv GPR[32];
 TCGv CR[32];
 TCGv SR[64];
@@ -244,6 +248,8 @@ static inline void handle_packet_begin(DisasContext *dc)
 
 static inline void handle_packet_end(DisasContext *dc)
 {
+    uint64_t written = dc->regs.written;
+
     LOG_DIS(" }");
 
     solve_dependencies(dc);
@@ -258,6 +264,21 @@ static inline void handle_packet_end(DisasContext *dc)
             tcg_gen_mov_tl(CR[i], CR_new[i]);
     }
 
+    /*
+     * The trap is taken after the packet has committed, whichever slot it
+     * was in; it has already set ELR and the handler address.
+     */
+    if (dc->trap) {
+        TCGv pc = tcg_const_i32(dc->pc);
+        TCGv index = tcg_const_i32(dc->trap_index);
+        tcg_gen_st_i32(pc, cpu_env, offsetof(CPUHexagonState, trap_pc));
+        gen_helper_handle_trap(cpu_env, index);
+        tcg_temp_free_i32(pc);
+        tcg_temp_free_i32(index);
+        dc->pc_written = true;
+        dc->trap = false;
+    }
+
     // Clear temp registers
     for (int i = 0; i < 32; i++) {
         if (GET_USED_REG(dc->regs, i))
@@ -279,6 +300,9 @@ static inline void handle_packet_end(DisasContext *dc)
         tcg_gen_addi_i32(tmp, pc, 4);
         tcg_gen_movcond_i32(TCG_COND_GT, CR[CR_PC], PC_written, zero, CR[CR_PC], tmp);
         tcg_gen_movi_i32(PC_written, 0);
+        tcg_temp_free_i32(tmp);
+        tcg_temp_free_i32(zero);
+        tcg_temp_free_i32(pc);
     }
 
     /* Inject initialization for conditional registers */
@@ -319,11 +343,16 @@ static inline void handle_packet_end(DisasContext *dc)
 
     /* Handle hardware loops */
     if (dc->endloop[0] || dc->endloop[1]) {
-        if (dc->endloop[0] && dc->endloop[1])
-            endloop01();
-        else if (dc->endloop[0]) {
+        /* Skip the pipelined loop update when it is known to be off */
+        bool lpcfg_zero = (dc->tb->flags & HEX_TB_FLAG_LPCFG_ZERO) &&
+                          !dc->lpcfg_written;
+
+        dc->is_endloop = true;
+        if (dc->endloop[0] && dc->endloop[1]) {
+            lpcfg_zero ? endloop01_lpcfg_zero() : endloop01();
+        } else if (dc->endloop[0]) {
             LOG_DIS(" :endloop0");
-            endloop0();
+            lpcfg_zero ? endloop0_lpcfg_zero() : endloop0();
         }
         else if (dc->endloop[1]) {
             LOG_DIS(" :endloop1");
@@ -338,9 +367,16 @@ static inline void handle_packet_end(DisasContext *dc)
         tcg_gen_addi_i32(tmp, pc, 4);
         tcg_gen_movcond_i32(TCG_COND_GT, CR[CR_PC], PC_written, zero, CR[CR_PC], tmp);
         tcg_gen_movi_tl(PC_written, 0);
+        tcg_temp_free_i32(tmp);
+        tcg_temp_free_i32(zero);
+        tcg_temp_free_i32(pc);
     }
     dc->endloop[0] = false;
     dc->endloop[1] = false;
+
+    if (hexagon_trace_enabled) {
+        hexagon_trace_gen_packet(dc->packet_first_op, dc->pc, written);
+    }
 };
 
 static inline void decode_packet(DisasContext *dc, CPUState *cs, uint32_t ir)
@@ -449,18 +485,6 @@ static inline void decode_packet(DisasContext *dc, CPUState *cs, uint32_t ir)
         dc->const_ext = 0;
     }
 
-#ifdef DUMP_EVERY_INST
-            /* Inject CPU dump */
-        	TCGv_i32 tmp_0 = tcg_const_i32(1);
-        	gen_helper_handle_trap(cpu_env, tmp_0);
-        	tcg_temp_free_i32(tmp_0);
-
-            /* Inject stack trace */
-        	TCGv_i32 tmp_1 = tcg_const_i32(8);
-        	gen_helper_handle_trap(cpu_env, tmp_1);
-        	tcg_temp_free_i32(tmp_1);
-#endif
-
     /* Instruction end */
     dc->deps[dc->i].end = tcg_last_op();
 
@@ -469,8 +493,8 @@ static inline void decode_packet(DisasContext *dc, CPUState *cs, uint32_t ir)
         dc->new_packet = true;
 
     }
-    /* If instruction is a trap0 or if pc has been written, close block */
-    if (ir == 0x5400c000 || dc->pc_written) {
+    /* If the packet has trapped or written the pc, close block */
+    if (dc->pc_written) {
         dc->block_end = true;
         dc->pc_written = false;
     }
@@ -478,6 +502,44 @@ static inline void decode_packet(DisasContext *dc, CPUState *cs, uint32_t ir)
 
 };
 
+/* Count the packets of the block, read by the EXECSTATS semihosting call */
+static void gen_packet_count(DisasContext *dc, int npackets)
+{
+    TCGv_i64 count;
+
+    if (!(dc->tb->flags & HEX_TB_FLAG_COUNT_PACKETS)) {
+        return;
+    }
+    count = tcg_temp_new_i64();
+    tcg_gen_ld_i64(count, cpu_env, offsetof(CPUHexagonState, packet_count));
+    tcg_gen_addi_i64(count, count, npackets);
+    tcg_gen_st_i64(count, cpu_env, offsetof(CPUHexagonState, packet_count));
+    tcg_temp_free_i64(count);
+}
+
+/*
+ * The block is the body of a hardware loop and ends with its endloop: when
+ * branching back, chain the block to itself, provided that the state its
+ * flags were computed from is unchanged.
+ */
+static void gen_loop_chain(DisasContext *dc, uint32_t pc_start, int npackets)
+{
+    uint32_t flags = dc->tb->flags;
+    TCGLabel *exit = gen_new_label();
+
+    tcg_gen_brcondi_tl(TCG_COND_NE, CR[CR_PC], pc_start, exit);
+    tcg_gen_brcondi_tl(flags & HEX_TB_FLAG_LPCFG_ZERO ?
+                       TCG_COND_NE : TCG_COND_EQ, LPCFG, 0, exit);
+    tcg_gen_brcondi_tl(flags & HEX_TB_FLAG_LOOP0_START ?
+                       TCG_COND_NE : TCG_COND_EQ, SA[0], pc_start, exit);
+    tcg_gen_brcondi_tl(flags & HEX_TB_FLAG_LOOP1_START ?
+                       TCG_COND_NE : TCG_COND_EQ, SA[1], pc_start, exit);
+    gen_packet_count(dc, npackets);
+    tcg_gen_goto_tb(0);
+    tcg_gen_exit_tb(dc->tb, 0);
+    gen_set_label(exit);
+}
+
 /* generate intermediate code for basic block 'tb'.  */
 void gen_intermediate_code(CPUState *cs, struct TranslationBlock *tb)
 {
@@ -488,8 +550,13 @@ void gen_intermediate_code(CPUState *cs, struct TranslationBlock *tb)
     struct DisasContext *dc = &ctx;
     int num_insns;
     int max_insns;
+    uint32_t packets[TCG_MAX_INSNS];
     uint32_t insn;
     uint8_t parse_bits;
+    HexagonSideExit exits[TCG_MAX_INSNS];
+    int nexits = 0;
+    uint32_t next, limit;
+    bool superblock;
 
     pc_start = tb->pc;
     dc->cpu = cpu;
@@ -513,7 +580,21 @@ void gen_intermediate_code(CPUState *cs, struct TranslationBlock *tb)
         max_insns = TCG_MAX_INSNS;
     }
 
+    /* Superblocks must stay within the two pages a TB can span */
+    limit = (pc_start & TARGET_PAGE_MASK) + 2 * TARGET_PAGE_SIZE;
+    /* The reference traces of -hexagon-lockstep are checked per block */
+    superblock = hexagon_superblock_enabled && !hexagon_lockstep_enabled &&
+                 !singlestep;
+
     gen_tb_start(tb);
+    /* Cold blocks are translated quickly, see tier.c */
+    if (hexagon_tier_threshold && hexagon_tier_gen_tb_start(tb)) {
+        superblock = false;
+    }
+    hexagon_profile_tb_start(tb);
+    if (hexagon_lockstep_enabled) {
+        hexagon_lockstep_gen_tb_start();
+    }
     do
     {
         if (dc->new_packet) {
@@ -529,11 +610,19 @@ void gen_intermediate_code(CPUState *cs, struct TranslationBlock *tb)
             if (pc_iter == dc->instruction_pc)
                 pc_iter += 4;
             dc->npc = pc_iter;
+            dc->jump_count = 0;
+            dc->branch_count = 0;
+            dc->branch_hint = false;
+            dc->is_endloop = false;
 
             /* Emit an instruction start only when a packet begins */
-            tcg_gen_insn_start(dc->pc);
+            tcg_gen_insn_start(dc->instruction_pc);
+            packets[num_insns] = dc->instruction_pc;
             num_insns++;
             dc->pc = dc->instruction_pc;
+            if (hexagon_snapshot_enabled) {
+                hexagon_snapshot_gen_packet(dc->pc);
+            }
         }
 
         /* Pretty disas.  */
@@ -541,17 +630,68 @@ void gen_intermediate_code(CPUState *cs, struct TranslationBlock *tb)
 
         /* Fetch instructions from memory and decode them */
         insn = cpu_ldl_code(env, dc->instruction_pc);
+        tcg_clear_temp_count();
         decode_packet(dc, cs, insn);
+        if (tcg_check_temp_count()) {
+            qemu_log("Instruction at %08x leaked TCG temporaries\n",
+                     dc->instruction_pc);
+        }
         dc->old_pc = dc->instruction_pc;
         dc->instruction_pc += 4;
+
+        /* Continue past a biased branch, see superblock.c */
+        if (superblock && dc->new_packet && dc->block_end &&
+            dc->branch_count == 1 && !dc->is_call) {
+            next = hexagon_superblock_gen_branch(dc->pc, dc->branch_target,
+                                                 dc->npc, dc->branch_hint,
+                                                 limit, num_insns,
+                                                 &exits[nexits]);
+            if (next != 0) {
+                nexits++;
+                dc->instruction_pc = next;
+                dc->block_end = false;
+            }
+        }
+
+        /*
+         * Stop at a packet boundary, continuing in the next TB, before the
+         * next packet could leave the two pages of the block
+         */
+        if (dc->new_packet && !dc->block_end &&
+            (singlestep || num_insns >= max_insns ||
+             dc->instruction_pc > limit - SB_MAX_PACKET_SIZE)) {
+            tcg_gen_movi_tl(CR[CR_PC], dc->instruction_pc);
+            dc->block_end = true;
+        }
     } while (!dc->block_end);
 
-    /* Use the hash table to find the next TB */
-    tcg_gen_exit_tb(NULL, 0);
+    if (dc->is_endloop && !dc->is_call && !dc->is_return &&
+        (tb->flags & (HEX_TB_FLAG_LOOP0_START | HEX_TB_FLAG_LOOP1_START))) {
+        gen_loop_chain(dc, pc_start, num_insns);
+    }
+    gen_packet_count(dc, num_insns);
+    if (dc->is_return) {
+        hexagon_ras_gen_return(dc->npc);
+    } else {
+        if (dc->is_call) {
+            hexagon_ras_gen_call(dc->npc);
+        }
+        /* Use the hash table to find the next TB */
+        tcg_gen_exit_tb(NULL, 0);
+    }
+    for (int i = 0; i < nexits; i++) {
+        hexagon_superblock_gen_side_exit(&exits[i]);
+        gen_packet_count(dc, exits[i].npackets);
+        tcg_gen_exit_tb(NULL, 0);
+    }
     gen_tb_end(tb, num_insns);
 
     tb->size = dc->instruction_pc - pc_start;
     tb->icount = num_insns;
+    hexagon_profile_tb_end(tb, packets, num_insns);
+    if (hexagon_lockstep_enabled) {
+        hexagon_lockstep_gen_tb_end(packets, num_insns);
+    }
 }
 
 void hexagon_cpu_dump_state(CPUState *cs, FILE *f, fprintf_function cpu_fprintf,
@@ -639,6 +779,7 @@ void hexagon_tcg_init(void)
                                offsetof(CPUHexagonState, lpcfg),
                                hwloop_regnames[4]);
 
+    hexagon_ras_init();
 }
 
 void restore_state_to_opc(CPUHexagonState *env, TranslationBlock *tb,
@@ -0,0 +1,272 @@
+/*
+ * Hexagon warm start cache
+ *
+ * Copyright (c) 2017-2019 Comsecuris UG (haftungsbeschraenkt)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*
+ * Warm start cache
+ *
+ * With -hexagon-tier and -hexagon-superblock, every run learns again which
+ * blocks are hot and which way their branches go before it translates them
+ * well.  With -hexagon-warm-cache, these decisions are saved to a file at
+ * exit and used from the start of the next run, so that a guest run over
+ * and over again, e.g. by a test suite, gets its hot blocks optimized and
+ * its superblocks formed on their first translation.
+ *
+ * Only decisions are saved, not translated code, which would refer to the
+ * addresses of helpers and of the data of the run that produced it.  The
+ * decisions are looked up when a block is translated, and a wrong one only
+ * costs performance: a superblock still leaves through its side exit when
+ * the branch goes the other way.  Each is saved with a CRC of the code it
+ * was made for, and ignored if the code differs, and the file is ignored
+ * if it was written by another QEMU version.  Self-modifying code is still
+ * tracked by the translation cache as usual.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/error-report.h"
+#include "qemu/thread.h"
+#include "qemu-version.h"
+#include "cpu.h"
+#include "exec/exec-all.h"
+#include "warmcache.h"
+#include <zlib.h>
+
+#define WARM_MAGIC "HEXWARM"
+#define WARM_VERSION 1
+
+/* Code hashed from the address of a decision, within its page */
+#define WARM_HASH_BYTES 64
+
+enum {
+    WARM_HOT,
+    WARM_BRANCH,
+};
+
+typedef struct HexagonWarmHeader {
+    char magic[8];
+    uint32_t version;
+    /* CRC of the QEMU version */
+    uint32_t build;
+    uint32_t count;
+    uint32_t reserved;
+} HexagonWarmHeader;
+
+typedef struct HexagonWarmRecord {
+    uint32_t kind;
+    uint32_t pc;
+    uint32_t hash;
+    /* Branches only */
+    uint32_t target;
+    uint32_t npc;
+    int32_t state;
+} HexagonWarmRecord;
+
+bool hexagon_warm_cache_enabled;
+static char *warm_path;
+static QemuMutex warm_lock;
+/* Records indexed by pc, one table per kind */
+static GHashTable *warm_hot;
+static GHashTable *warm_branches;
+
+static uint32_t warm_build(void)
+{
+    return crc32(0, (const Bytef *)QEMU_FULL_VERSION,
+                 strlen(QEMU_FULL_VERSION));
+}
+
+static bool warm_code_hash(uint32_t pc, uint32_t *hash)
+{
+    uint32_t len = MIN(WARM_HASH_BYTES,
+                       TARGET_PAGE_SIZE - (pc & ~TARGET_PAGE_MASK));
+
+    if (page_check_range(pc, len, PAGE_READ) != 0) {
+        return false;
+    }
+    *hash = crc32(0, g2h(pc), len);
+    return true;
+}
+
+static GHashTable *warm_table(uint32_t kind)
+{
+    return kind == WARM_HOT ? warm_hot : warm_branches;
+}
+
+static void warm_load(void)
+{
+    HexagonWarmHeader *header;
+    HexagonWarmRecord *records;
+    gchar *buf;
+    gsize len;
+    uint32_t i;
+
+    if (!g_file_get_contents(warm_path, &buf, &len, NULL)) {
+        /* First run */
+        return;
+    }
+    header = (HexagonWarmHeader *)buf;
+    records = (HexagonWarmRecord *)(header + 1);
+    if (len < sizeof(*header) ||
+        memcmp(header->magic, WARM_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != WARM_VERSION ||
+        len != sizeof(*header) + header->count * sizeof(*records)) {
+        warn_report("Ignoring invalid warm start cache %s", warm_path);
+    } else if (header->build == warm_build()) {
+        for (i = 0; i < header->count; i++) {
+            if (records[i].kind == WARM_HOT || records[i].kind == WARM_BRANCH) {
+                g_hash_table_insert(warm_table(records[i].kind),
+                                    GUINT_TO_POINTER(records[i].pc),
+                                    g_memdup(&records[i], sizeof(*records)));
+            }
+        }
+    }
+    g_free(buf);
+}
+
+void hexagon_warm_cache_save(void)
+{
+    HexagonWarmHeader header = { WARM_MAGIC, WARM_VERSION };
+    GByteArray *data;
+    GHashTableIter iter;
+    gpointer value;
+    GError *err = NULL;
+
+    if (!hexagon_warm_cache_enabled) {
+        return;
+    }
+
+    qemu_mutex_lock(&warm_lock);
+    header.build = warm_build();
+    header.count = g_hash_table_size(warm_hot) +
+                   g_hash_table_size(warm_branches);
+    data = g_byte_array_new();
+    g_byte_array_append(data, (guint8 *)&header, sizeof(header));
+    g_hash_table_iter_init(&iter, warm_hot);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+        g_byte_array_append(data, value, sizeof(HexagonWarmRecord));
+    }
+    g_hash_table_iter_init(&iter, warm_branches);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+        g_byte_array_append(data, value, sizeof(HexagonWarmRecord));
+    }
+    qemu_mutex_unlock(&warm_lock);
+
+    /* Replaced atomically, the last of concurrent runs wins */
+    if (!g_file_set_contents(warm_path, (gchar *)data->data, data->len,
+                             &err)) {
+        error_report("Could not save warm start cache: %s", err->message);
+        g_error_free(err);
+    }
+    g_byte_array_free(data, true);
+}
+
+void hexagon_warm_cache_init(const char *path)
+{
+    warm_path = g_strdup(path);
+    qemu_mutex_init(&warm_lock);
+    warm_hot = g_hash_table_new_full(NULL, NULL, NULL, g_free);
+    warm_branches = g_hash_table_new_full(NULL, NULL, NULL, g_free);
+    warm_load();
+    hexagon_warm_cache_enabled = true;
+}
+
+/* The record of @kind for @pc, if made for the current code */
+static HexagonWarmRecord *warm_lookup(uint32_t kind, uint32_t pc)
+{
+    HexagonWarmRecord *r;
+    uint32_t hash;
+
+    r = g_hash_table_lookup(warm_table(kind), GUINT_TO_POINTER(pc));
+    if (r != NULL && (!warm_code_hash(pc, &hash) || r->hash != hash)) {
+        g_hash_table_remove(warm_table(kind), GUINT_TO_POINTER(pc));
+        r = NULL;
+    }
+    return r;
+}
+
+static void warm_record(uint32_t kind, uint32_t pc, uint32_t target,
+                        uint32_t npc, int state)
+{
+    HexagonWarmRecord *r;
+    uint32_t hash;
+
+    if (!warm_code_hash(pc, &hash)) {
+        return;
+    }
+    r = g_new0(HexagonWarmRecord, 1);
+    r->kind = kind;
+    r->pc = pc;
+    r->hash = hash;
+    r->target = target;
+    r->npc = npc;
+    r->state = state;
+    g_hash_table_insert(warm_table(kind), GUINT_TO_POINTER(pc), r);
+}
+
+bool hexagon_warm_cache_hot(uint32_t pc)
+{
+    bool hot;
+
+    qemu_mutex_lock(&warm_lock);
+    hot = warm_lookup(WARM_HOT, pc) != NULL;
+    qemu_mutex_unlock(&warm_lock);
+    return hot;
+}
+
+void hexagon_warm_cache_set_hot(uint32_t pc)
+{
+    qemu_mutex_lock(&warm_lock);
+    warm_record(WARM_HOT, pc, 0, 0, 0);
+    qemu_mutex_unlock(&warm_lock);
+}
+
+bool hexagon_warm_cache_branch(uint32_t pc, uint32_t target, uint32_t npc,
+                               int *state)
+{
+    HexagonWarmRecord *r;
+    bool found = false;
+
+    qemu_mutex_lock(&warm_lock);
+    r = warm_lookup(WARM_BRANCH, pc);
+    if (r != NULL && r->target == target && r->npc == npc) {
+        *state = r->state;
+        found = true;
+    }
+    qemu_mutex_unlock(&warm_lock);
+    return found;
+}
+
+void hexagon_warm_cache_set_branch(uint32_t pc, uint32_t target,
+                                   uint32_t npc, int state)
+{
+    qemu_mutex_lock(&warm_lock);
+    warm_record(WARM_BRANCH, pc, target, npc, state);
+    qemu_mutex_unlock(&warm_lock);
+}
+
+void hexagon_warm_cache_forget_branch(uint32_t pc)
+{
+    qemu_mutex_lock(&warm_lock);
+    g_hash_table_remove(warm_branches, GUINT_TO_POINTER(pc));
+    qemu_mutex_unlock(&warm_lock);
+}
@@ -0,0 +1,49 @@
+/*
+ * Hexagon warm start cache
+ *
+ * Copyright (c) 2017-2019 Comsecuris UG (haftungsbeschraenkt)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef HEXAGON_WARMCACHE_H
+#define HEXAGON_WARMCACHE_H
+
+extern bool hexagon_warm_cache_enabled;
+
+/*
+ * Whether the block at @pc was optimized by -hexagon-tier in a previous
+ * run, its code being unchanged since.
+ */
+bool hexagon_warm_cache_hot(uint32_t pc);
+void hexagon_warm_cache_set_hot(uint32_t pc);
+
+/*
+ * The state superblock.c reached in a previous run for the branch of the
+ * packet at @pc to @target, falling through to @npc.  Returns false if
+ * there is none, or if the code has changed since.
+ */
+bool hexagon_warm_cache_branch(uint32_t pc, uint32_t target, uint32_t npc,
+                               int *state);
+void hexagon_warm_cache_set_branch(uint32_t pc, uint32_t target,
+                                   uint32_t npc, int state);
+void hexagon_warm_cache_forget_branch(uint32_t pc);
+
+#endif
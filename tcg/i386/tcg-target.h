@@ -27,6 +27,7 @@
 
 #define TCG_TARGET_INSN_UNIT_SIZE  1
 #define TCG_TARGET_TLB_DISPLACEMENT_BITS 31
+#define TCG_TARGET_IMPLEMENTS_DYN_TLB 1
 
 #ifdef __x86_64__
 # define TCG_TARGET_REG_BITS  64
@@ -99,6 +100,7 @@ extern bool have_bmi1;
 extern bool have_popcnt;
 extern bool have_avx1;
 extern bool have_avx2;
+extern bool have_avx512;
 
 /* optional instructions */
 #define TCG_TARGET_HAS_div2_i32         1
@@ -172,6 +174,8 @@ extern bool have_avx2;
 #define TCG_TARGET_HAS_v64              have_avx1
 #define TCG_TARGET_HAS_v128             have_avx1
 #define TCG_TARGET_HAS_v256             have_avx2
+/* AVX-512 is used with F, BW and DQ, on 64-bit hosts only.  */
+#define TCG_TARGET_HAS_v512             have_avx512
 
 #define TCG_TARGET_HAS_andc_vec         1
 #define TCG_TARGET_HAS_orc_vec          0
@@ -226,6 +230,9 @@ static inline void tb_target_set_jmp_target(uintptr_t tc_ptr,
 #ifdef CONFIG_SOFTMMU
 #define TCG_TARGET_NEED_LDST_LABELS
 #endif
+/* Branches reach the whole of code_gen_buffer, so the slow paths can be
+   moved away from the TB bodies.  */
+#define TCG_TARGET_COLD_CODE
 #define TCG_TARGET_NEED_POOL_LABELS
 
 #endif
@@ -42,7 +42,9 @@ struct tcg_temp_info {
     TCGTemp *prev_copy;
     TCGTemp *next_copy;
     tcg_target_ulong val;
+    /* Bits which may be set, and bits known to be set */
     tcg_target_ulong mask;
+    tcg_target_ulong omask;
 };
 
 static inline struct tcg_temp_info *ts_info(TCGTemp *ts)
@@ -83,6 +85,7 @@ static void reset_ts(TCGTemp *ts)
     ti->prev_copy = ts;
     ti->is_const = false;
     ti->mask = -1;
+    ti->omask = 0;
 }
 
 static void reset_temp(TCGArg arg)
@@ -103,6 +106,7 @@ static void init_ts_info(struct tcg_temp_info *infos,
         ti->prev_copy = ts;
         ti->is_const = false;
         ti->mask = -1;
+        ti->omask = 0;
         set_bit(idx, temps_used->l);
     }
 }
@@ -172,7 +176,7 @@ static void tcg_opt_gen_movi(TCGContext *s, TCGOp *op, TCGArg dst, TCGArg val)
 {
     const TCGOpDef *def;
     TCGOpcode new_op;
-    tcg_target_ulong mask;
+    tcg_target_ulong mask, omask;
     struct tcg_temp_info *di = arg_info(dst);
 
     def = &tcg_op_defs[op->opc];
@@ -192,11 +196,14 @@ static void tcg_opt_gen_movi(TCGContext *s, TCGOp *op, TCGArg dst, TCGArg val)
     di->is_const = true;
     di->val = val;
     mask = val;
+    omask = new_op == INDEX_op_dupi_vec ? 0 : val;
     if (TCG_TARGET_REG_BITS > 32 && new_op == INDEX_op_movi_i32) {
         /* High bits of the destination are now garbage.  */
         mask |= ~0xffffffffull;
+        omask &= 0xffffffffull;
     }
     di->mask = mask;
+    di->omask = omask;
 }
 
 static void tcg_opt_gen_mov(TCGContext *s, TCGOp *op, TCGArg dst, TCGArg src)
@@ -206,7 +213,7 @@ static void tcg_opt_gen_mov(TCGContext *s, TCGOp *op, TCGArg dst, TCGArg src)
     const TCGOpDef *def;
     struct tcg_temp_info *di;
     struct tcg_temp_info *si;
-    tcg_target_ulong mask;
+    tcg_target_ulong mask, omask;
     TCGOpcode new_op;
 
     if (ts_are_copies(dst_ts, src_ts)) {
@@ -231,11 +238,14 @@ static void tcg_opt_gen_mov(TCGContext *s, TCGOp *op, TCGArg dst, TCGArg src)
     op->args[1] = src;
 
     mask = si->mask;
+    omask = si->omask;
     if (TCG_TARGET_REG_BITS > 32 && new_op == INDEX_op_mov_i32) {
         /* High bits of the destination are now garbage.  */
         mask |= ~0xffffffffull;
+        omask &= 0xffffffffull;
     }
     di->mask = mask;
+    di->omask = omask;
 
     if (src_ts->type == dst_ts->type) {
         struct tcg_temp_info *ni = ts_info(si->next_copy);
@@ -506,7 +516,20 @@ static TCGArg do_constant_folding_cond(TCGOpcode op, TCGArg x,
         }
     } else if (args_are_copies(x, y)) {
         return do_constant_folding_cond_eq(c);
-    } else if (arg_is_const(y) && yv == 0) {
+    } else if (arg_is_const(y) && (c == TCG_COND_EQ || c == TCG_COND_NE)) {
+        const TCGOpDef *def = &tcg_op_defs[op];
+        tcg_target_ulong known = arg_info(x)->omask & ~yv;
+
+        /* A bit known to differ from Y makes X != Y */
+        known |= yv & ~arg_info(x)->mask;
+        if (!(def->flags & TCG_OPF_64BIT)) {
+            known &= 0xffffffffu;
+        }
+        if (known) {
+            return c == TCG_COND_NE;
+        }
+    }
+    if (arg_is_const(y) && yv == 0) {
         switch (c) {
         case TCG_COND_LTU:
             return 0;
@@ -587,13 +610,250 @@ static bool swap_commutative2(TCGArg *p1, TCGArg *p2)
     return false;
 }
 
+/* Facts known about a global or local temp at a label.  */
+struct tcg_temp_fact {
+    size_t idx;
+    bool is_const;
+    tcg_target_ulong val;
+    tcg_target_ulong mask;
+    tcg_target_ulong omask;
+    /* Lowest index in the temp's list of copies, the temp included */
+    size_t copy;
+    /* The same once intersected with another path, see intersect_facts */
+    size_t new_copy;
+};
+
+/* Globals and local temps survive the end of a basic block, so what is
+   known about them can be carried along the fall-through path and into
+   a label, as long as every branch to the label has been seen: the facts
+   at the label are those which hold on all of the branches.  They are
+   saved for the temps in use on the first branch only, sorted by index,
+   and only those still in USED hold.  */
+struct tcg_label_info {
+    int refs;
+    int merged;
+    TCGTempSet used;
+    struct tcg_temp_fact *facts;
+    size_t nb_facts;
+};
+
+/* Plain temps are dead at the end of a basic block, forget them.  */
+static void reset_bb_temps(TCGContext *s, TCGTempSet *temps_used)
+{
+    size_t nb_temps = s->nb_temps;
+    size_t i;
+
+    for (i = find_next_bit(temps_used->l, nb_temps, s->nb_globals);
+         i < nb_temps;
+         i = find_next_bit(temps_used->l, nb_temps, i + 1)) {
+        TCGTemp *ts = &s->temps[i];
+        if (!ts->temp_local) {
+            reset_ts(ts);
+            clear_bit(i, temps_used->l);
+        }
+    }
+}
+
+static struct tcg_temp_fact *find_fact(struct tcg_label_info *li, size_t idx)
+{
+    size_t lo = 0, hi = li->nb_facts;
+
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (li->facts[mid].idx < idx) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    tcg_debug_assert(lo < li->nb_facts && li->facts[lo].idx == idx);
+    return &li->facts[lo];
+}
+
+static void save_facts(TCGContext *s, TCGTempSet *temps_used,
+                       struct tcg_label_info *li)
+{
+    size_t nb_temps = s->nb_temps;
+    struct tcg_temp_fact *f;
+    size_t i;
+
+    li->used = *temps_used;
+    li->nb_facts = bitmap_count_one(temps_used->l, nb_temps);
+    li->facts = tcg_malloc(sizeof(struct tcg_temp_fact) * li->nb_facts);
+    f = li->facts;
+    for (i = find_first_bit(temps_used->l, nb_temps);
+         i < nb_temps;
+         i = find_next_bit(temps_used->l, nb_temps, i + 1), f++) {
+        TCGTemp *ts = &s->temps[i], *c;
+        struct tcg_temp_info *ti = ts_info(ts);
+
+        f->idx = i;
+        f->is_const = ti->is_const;
+        f->val = ti->val;
+        f->mask = ti->mask;
+        f->omask = ti->omask;
+        f->copy = i;
+        for (c = ti->next_copy; c != ts; c = ts_info(c)->next_copy) {
+            f->copy = MIN(f->copy, temp_idx(c));
+        }
+    }
+}
+
+/* Keep in LI the facts which also hold for the temps in TEMPS_USED.  */
+static void intersect_facts(TCGContext *s, struct tcg_label_info *li,
+                            TCGTempSet *temps_used)
+{
+    struct tcg_temp_fact *a, *b;
+    size_t k;
+
+    bitmap_and(li->used.l, li->used.l, temps_used->l, s->nb_temps);
+    for (k = 0; k < li->nb_facts; k++) {
+        li->facts[k].new_copy = SIZE_MAX;
+    }
+    for (k = 0; k < li->nb_facts; k++) {
+        TCGTemp *ts, *c;
+        struct tcg_temp_info *ti;
+
+        a = &li->facts[k];
+        if (!test_bit(a->idx, li->used.l)) {
+            continue;
+        }
+        ts = &s->temps[a->idx];
+        ti = ts_info(ts);
+        a->is_const &= ti->is_const && a->val == ti->val;
+        a->mask |= ti->mask;
+        a->omask &= ti->omask;
+        if (a->new_copy != SIZE_MAX) {
+            continue;
+        }
+
+        /* Two temps remain copies if they are on both paths; the list
+           is again named after its lowest index, the first one met.  */
+        a->new_copy = a->idx;
+        for (c = ti->next_copy; c != ts; c = ts_info(c)->next_copy) {
+            if (!test_bit(temp_idx(c), li->used.l)) {
+                continue;
+            }
+            b = find_fact(li, temp_idx(c));
+            if (b->new_copy == SIZE_MAX && b->copy == a->copy) {
+                b->new_copy = a->idx;
+            }
+        }
+    }
+    for (k = 0; k < li->nb_facts; k++) {
+        li->facts[k].copy = li->facts[k].new_copy;
+    }
+}
+
+static void restore_facts(TCGContext *s, struct tcg_temp_info *infos,
+                          TCGTempSet *temps_used, struct tcg_label_info *li)
+{
+    size_t k;
+
+    bitmap_zero(temps_used->l, s->nb_temps);
+    for (k = 0; k < li->nb_facts; k++) {
+        struct tcg_temp_fact *f = &li->facts[k];
+        TCGTemp *ts = &s->temps[f->idx];
+        struct tcg_temp_info *ti;
+
+        if (!test_bit(f->idx, li->used.l)) {
+            continue;
+        }
+        init_ts_info(infos, temps_used, ts);
+        ti = ts_info(ts);
+        ti->is_const = f->is_const;
+        ti->val = f->val;
+        ti->mask = f->mask;
+        ti->omask = f->omask;
+        if (f->copy != f->idx) {
+            TCGTemp *cs = &s->temps[f->copy];
+            struct tcg_temp_info *ci = ts_info(cs);
+
+            ti->next_copy = ci->next_copy;
+            ti->prev_copy = cs;
+            ts_info(ci->next_copy)->prev_copy = ts;
+            ci->next_copy = ts;
+        }
+    }
+}
+
+/* Record the facts which hold on a branch to LI.  */
+static void merge_label_facts(TCGContext *s, struct tcg_label_info *li,
+                              TCGTempSet *temps_used)
+{
+    if (li->merged++ == 0) {
+        save_facts(s, temps_used, li);
+    } else {
+        intersect_facts(s, li, temps_used);
+    }
+}
+
+static struct tcg_label_info *label_info(struct tcg_label_info *labels,
+                                         TCGArg arg)
+{
+    return &labels[arg_label(arg)->id];
+}
+
+/* OP ends a basic block: decide what is known where execution continues.
+   Return false if OP never falls through to the next op.  */
+static bool end_bb(TCGContext *s, struct tcg_temp_info *infos,
+                   TCGTempSet *temps_used, struct tcg_label_info *labels,
+                   TCGOp *op, bool fallthrough)
+{
+    struct tcg_label_info *li;
+
+    reset_bb_temps(s, temps_used);
+
+    switch (op->opc) {
+    case INDEX_op_set_label:
+        li = label_info(labels, op->args[0]);
+        if (li->merged < li->refs) {
+            /* A backward branch, whose facts are not known yet.  */
+            bitmap_zero(temps_used->l, s->nb_temps);
+        } else if (li->merged) {
+            if (fallthrough) {
+                merge_label_facts(s, li, temps_used);
+            }
+            restore_facts(s, infos, temps_used, li);
+        } else if (!fallthrough) {
+            bitmap_zero(temps_used->l, s->nb_temps);
+        }
+        return true;
+
+    case INDEX_op_br:
+        merge_label_facts(s, label_info(labels, op->args[0]), temps_used);
+        bitmap_zero(temps_used->l, s->nb_temps);
+        return false;
+
+    case INDEX_op_brcond_i32:
+    case INDEX_op_brcond_i64:
+        merge_label_facts(s, label_info(labels, op->args[3]), temps_used);
+        return true;
+
+    case INDEX_op_brcond2_i32:
+        merge_label_facts(s, label_info(labels, op->args[5]), temps_used);
+        return true;
+
+    case INDEX_op_exit_tb:
+    case INDEX_op_goto_ptr:
+        bitmap_zero(temps_used->l, s->nb_temps);
+        return false;
+
+    default:
+        bitmap_zero(temps_used->l, s->nb_temps);
+        return true;
+    }
+}
+
 /* Propagate constants and copies, fold constant expressions. */
 void tcg_optimize(TCGContext *s)
 {
     int nb_temps, nb_globals;
     TCGOp *op, *op_next, *prev_mb = NULL;
     struct tcg_temp_info *infos;
+    struct tcg_label_info *labels;
     TCGTempSet temps_used;
+    bool fallthrough = true;
 
     /* Array VALS has an element for each temp.
        If this temp holds a constant then its value is kept in VALS' element.
@@ -605,8 +865,29 @@ void tcg_optimize(TCGContext *s)
     bitmap_zero(temps_used.l, nb_temps);
     infos = tcg_malloc(sizeof(struct tcg_temp_info) * nb_temps);
 
+    /* Count the branches to each label, so that facts are only carried
+       into a label once every path to it has been seen.  */
+    labels = tcg_malloc(sizeof(struct tcg_label_info) * s->nb_labels);
+    memset(labels, 0, sizeof(struct tcg_label_info) * s->nb_labels);
+    QTAILQ_FOREACH(op, &s->ops, link) {
+        switch (op->opc) {
+        case INDEX_op_br:
+            label_info(labels, op->args[0])->refs++;
+            break;
+        case INDEX_op_brcond_i32:
+        case INDEX_op_brcond_i64:
+            label_info(labels, op->args[3])->refs++;
+            break;
+        case INDEX_op_brcond2_i32:
+            label_info(labels, op->args[5])->refs++;
+            break;
+        default:
+            break;
+        }
+    }
+
     QTAILQ_FOREACH_SAFE(op, &s->ops, link, op_next) {
-        tcg_target_ulong mask, partmask, affected;
+        tcg_target_ulong mask, omask, partmask, affected;
         int nb_oargs, nb_iargs, i;
         TCGArg tmp;
         TCGOpcode opc = op->opc;
@@ -835,9 +1116,10 @@ void tcg_optimize(TCGContext *s)
             break;
         }
 
-        /* Simplify using known-zero bits. Currently only ops with a single
-           output argument is supported. */
+        /* Simplify using known-zero and known-one bits. Currently only ops
+           with a single output argument is supported. */
         mask = -1;
+        omask = 0;
         affected = -1;
         switch (opc) {
         CASE_OP_32_64(ext8s):
@@ -864,11 +1146,14 @@ void tcg_optimize(TCGContext *s)
 
         CASE_OP_32_64(and):
             mask = arg_info(op->args[2])->mask;
+            omask = arg_info(op->args[2])->omask;
             if (arg_is_const(op->args[2])) {
         and_const:
                 affected = arg_info(op->args[1])->mask & ~mask;
+                omask = mask;
             }
             mask = arg_info(op->args[1])->mask & mask;
+            omask &= arg_info(op->args[1])->omask;
             break;
 
         case INDEX_op_ext_i32_i64:
@@ -878,6 +1163,7 @@ void tcg_optimize(TCGContext *s)
         case INDEX_op_extu_i32_i64:
             /* We do not compute affected as it is a size changing op.  */
             mask = (uint32_t)arg_info(op->args[1])->mask;
+            omask = (uint32_t)arg_info(op->args[1])->omask;
             break;
 
         CASE_OP_32_64(andc):
@@ -887,20 +1173,25 @@ void tcg_optimize(TCGContext *s)
                 mask = ~arg_info(op->args[2])->mask;
                 goto and_const;
             }
-            /* But we certainly know nothing outside args[1] may be set. */
+            /* But we certainly know nothing outside args[1] may be set,
+               and what is known to be set in args[1] and known to be
+               clear in args[2] remains set.  */
             mask = arg_info(op->args[1])->mask;
+            omask = arg_info(op->args[1])->omask & ~arg_info(op->args[2])->mask;
             break;
 
         case INDEX_op_sar_i32:
             if (arg_is_const(op->args[2])) {
                 tmp = arg_info(op->args[2])->val & 31;
                 mask = (int32_t)arg_info(op->args[1])->mask >> tmp;
+                omask = (int32_t)arg_info(op->args[1])->omask >> tmp;
             }
             break;
         case INDEX_op_sar_i64:
             if (arg_is_const(op->args[2])) {
                 tmp = arg_info(op->args[2])->val & 63;
                 mask = (int64_t)arg_info(op->args[1])->mask >> tmp;
+                omask = (int64_t)arg_info(op->args[1])->omask >> tmp;
             }
             break;
 
@@ -908,26 +1199,31 @@ void tcg_optimize(TCGContext *s)
             if (arg_is_const(op->args[2])) {
                 tmp = arg_info(op->args[2])->val & 31;
                 mask = (uint32_t)arg_info(op->args[1])->mask >> tmp;
+                omask = (uint32_t)arg_info(op->args[1])->omask >> tmp;
             }
             break;
         case INDEX_op_shr_i64:
             if (arg_is_const(op->args[2])) {
                 tmp = arg_info(op->args[2])->val & 63;
                 mask = (uint64_t)arg_info(op->args[1])->mask >> tmp;
+                omask = (uint64_t)arg_info(op->args[1])->omask >> tmp;
             }
             break;
 
         case INDEX_op_extrl_i64_i32:
             mask = (uint32_t)arg_info(op->args[1])->mask;
+            omask = (uint32_t)arg_info(op->args[1])->omask;
             break;
         case INDEX_op_extrh_i64_i32:
             mask = (uint64_t)arg_info(op->args[1])->mask >> 32;
+            omask = (uint64_t)arg_info(op->args[1])->omask >> 32;
             break;
 
         CASE_OP_32_64(shl):
             if (arg_is_const(op->args[2])) {
                 tmp = arg_info(op->args[2])->val & (TCG_TARGET_REG_BITS - 1);
                 mask = arg_info(op->args[1])->mask << tmp;
+                omask = arg_info(op->args[1])->omask << tmp;
             }
             break;
 
@@ -941,11 +1237,16 @@ void tcg_optimize(TCGContext *s)
             mask = deposit64(arg_info(op->args[1])->mask,
                              op->args[3], op->args[4],
                              arg_info(op->args[2])->mask);
+            omask = deposit64(arg_info(op->args[1])->omask,
+                              op->args[3], op->args[4],
+                              arg_info(op->args[2])->omask);
             break;
 
         CASE_OP_32_64(extract):
             mask = extract64(arg_info(op->args[1])->mask,
                              op->args[2], op->args[3]);
+            omask = extract64(arg_info(op->args[1])->omask,
+                              op->args[2], op->args[3]);
             if (op->args[2] == 0) {
                 affected = arg_info(op->args[1])->mask & ~mask;
             }
@@ -953,14 +1254,28 @@ void tcg_optimize(TCGContext *s)
         CASE_OP_32_64(sextract):
             mask = sextract64(arg_info(op->args[1])->mask,
                               op->args[2], op->args[3]);
+            omask = sextract64(arg_info(op->args[1])->omask,
+                               op->args[2], op->args[3]);
             if (op->args[2] == 0 && (tcg_target_long)mask >= 0) {
                 affected = arg_info(op->args[1])->mask & ~mask;
             }
             break;
 
         CASE_OP_32_64(or):
+            mask = arg_info(op->args[1])->mask | arg_info(op->args[2])->mask;
+            omask = arg_info(op->args[1])->omask | arg_info(op->args[2])->omask;
+            if (arg_is_const(op->args[2])) {
+                affected = arg_info(op->args[2])->val
+                           & ~arg_info(op->args[1])->omask;
+            }
+            break;
         CASE_OP_32_64(xor):
             mask = arg_info(op->args[1])->mask | arg_info(op->args[2])->mask;
+            /* Set on one side and known to be clear on the other */
+            omask = (arg_info(op->args[1])->omask
+                     & ~arg_info(op->args[2])->mask)
+                    | (arg_info(op->args[2])->omask
+                       & ~arg_info(op->args[1])->mask);
             break;
 
         case INDEX_op_clz_i32:
@@ -987,6 +1302,7 @@ void tcg_optimize(TCGContext *s)
 
         CASE_OP_32_64(movcond):
             mask = arg_info(op->args[3])->mask | arg_info(op->args[4])->mask;
+            omask = arg_info(op->args[3])->omask & arg_info(op->args[4])->omask;
             break;
 
         CASE_OP_32_64(ld8u):
@@ -1021,6 +1337,7 @@ void tcg_optimize(TCGContext *s)
             mask |= ~(tcg_target_ulong)0xffffffffu;
             partmask &= 0xffffffffu;
             affected &= 0xffffffffu;
+            omask &= 0xffffffffu;
         }
 
         if (partmask == 0) {
@@ -1028,6 +1345,13 @@ void tcg_optimize(TCGContext *s)
             tcg_opt_gen_movi(s, op, op->args[0], 0);
             continue;
         }
+        if ((partmask & ~omask) == 0) {
+            /* Every bit which may be set is known to be set */
+            tcg_debug_assert(nb_oargs == 1);
+            tmp = def->flags & TCG_OPF_64BIT ? partmask : (int32_t)partmask;
+            tcg_opt_gen_movi(s, op, op->args[0], tmp);
+            continue;
+        }
         if (affected == 0) {
             tcg_debug_assert(nb_oargs == 1);
             tcg_opt_gen_mov(s, op, op->args[0], op->args[1]);
@@ -1204,10 +1528,12 @@ void tcg_optimize(TCGContext *s)
                                            op->args[1], op->args[2]);
             if (tmp != 2) {
                 if (tmp) {
-                    bitmap_zero(temps_used.l, nb_temps);
                     op->opc = INDEX_op_br;
                     op->args[0] = op->args[3];
+                    fallthrough = end_bb(s, infos, &temps_used, labels,
+                                         op, fallthrough);
                 } else {
+                    label_info(labels, op->args[3])->refs--;
                     tcg_op_remove(s, op);
                 }
                 break;
@@ -1287,11 +1613,13 @@ void tcg_optimize(TCGContext *s)
             if (tmp != 2) {
                 if (tmp) {
             do_brcond_true:
-                    bitmap_zero(temps_used.l, nb_temps);
                     op->opc = INDEX_op_br;
                     op->args[0] = op->args[5];
+                    fallthrough = end_bb(s, infos, &temps_used, labels,
+                                         op, fallthrough);
                 } else {
             do_brcond_false:
+                    label_info(labels, op->args[5])->refs--;
                     tcg_op_remove(s, op);
                 }
             } else if ((op->args[4] == TCG_COND_LT
@@ -1303,12 +1631,13 @@ void tcg_optimize(TCGContext *s)
                 /* Simplify LT/GE comparisons vs zero to a single compare
                    vs the high word of the input.  */
             do_brcond_high:
-                bitmap_zero(temps_used.l, nb_temps);
                 op->opc = INDEX_op_brcond_i32;
                 op->args[0] = op->args[1];
                 op->args[1] = op->args[3];
                 op->args[2] = op->args[4];
                 op->args[3] = op->args[5];
+                fallthrough = end_bb(s, infos, &temps_used, labels,
+                                     op, fallthrough);
             } else if (op->args[4] == TCG_COND_EQ) {
                 /* Simplify EQ comparisons where one of the pairs
                    can be simplified.  */
@@ -1329,11 +1658,12 @@ void tcg_optimize(TCGContext *s)
                     goto do_default;
                 }
             do_brcond_low:
-                bitmap_zero(temps_used.l, nb_temps);
                 op->opc = INDEX_op_brcond_i32;
                 op->args[1] = op->args[2];
                 op->args[2] = op->args[4];
                 op->args[3] = op->args[5];
+                fallthrough = end_bb(s, infos, &temps_used, labels,
+                                     op, fallthrough);
             } else if (op->args[4] == TCG_COND_NE) {
                 /* Simplify NE comparisons where one of the pairs
                    can be simplified.  */
@@ -1445,19 +1775,23 @@ void tcg_optimize(TCGContext *s)
         do_default:
             /* Default case: we know nothing about operation (or were unable
                to compute the operation result) so no propagation is done.
-               We trash everything if the operation is the end of a basic
-               block, otherwise we only trash the output args.  "mask" is
-               the non-zero bits mask for the first output arg.  */
+               If the operation is the end of a basic block, end_bb decides
+               what is still known after it, otherwise we only trash the
+               output args.  "mask" and "omask" are the non-zero and the
+               known-one bits masks for the first output arg.  */
             if (def->flags & TCG_OPF_BB_END) {
-                bitmap_zero(temps_used.l, nb_temps);
+                fallthrough = end_bb(s, infos, &temps_used, labels,
+                                     op, fallthrough);
             } else {
         do_reset_output:
                 for (i = 0; i < nb_oargs; i++) {
                     reset_temp(op->args[i]);
-                    /* Save the corresponding known-zero bits mask for the
-                       first output argument (only one supported so far). */
+                    /* Save the corresponding known-zero and known-one bits
+                       masks for the first output argument (only one
+                       supported so far). */
                     if (i == 0) {
                         arg_info(op->args[i])->mask = mask;
+                        arg_info(op->args[i])->omask = omask;
                     }
                 }
             }
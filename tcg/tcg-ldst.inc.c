@@ -41,7 +41,7 @@ typedef struct TCGLabelQemuLdst {
 static void tcg_out_qemu_ld_slow_path(TCGContext *s, TCGLabelQemuLdst *l);
 static void tcg_out_qemu_st_slow_path(TCGContext *s, TCGLabelQemuLdst *l);
 
-static bool tcg_out_ldst_finalize(TCGContext *s)
+static bool tcg_out_ldst_slow_paths(TCGContext *s)
 {
     TCGLabelQemuLdst *lb;
 
@@ -64,6 +64,38 @@ static bool tcg_out_ldst_finalize(TCGContext *s)
     return true;
 }
 
+static bool tcg_out_ldst_finalize(TCGContext *s)
+{
+#ifdef TCG_COLD_CODE
+    tcg_insn_unit *hot_ptr = s->code_ptr;
+    void *hot_highwater = s->code_gen_highwater;
+    void *cold_start = s->code_gen_cold_ptr;
+    bool ok;
+
+    if (QSIMPLEQ_EMPTY(&s->ldst_labels)) {
+        return true;
+    }
+
+    /* Move the slow paths out of line, to the cold part of the region.
+       On overflow this leaves it full, so that the next TB is allocated
+       in a new region.  */
+    s->code_ptr = s->code_gen_cold_ptr;
+    s->code_gen_highwater = s->code_gen_cold_highwater;
+    ok = tcg_out_ldst_slow_paths(s);
+    s->code_gen_cold_ptr = s->code_ptr;
+    s->code_gen_highwater = hot_highwater;
+    s->code_ptr = hot_ptr;
+    s->tb_cold_ptr = cold_start;
+    s->tb_cold_size = s->code_gen_cold_ptr - cold_start;
+
+    flush_icache_range((uintptr_t)cold_start,
+                       (uintptr_t)s->code_gen_cold_ptr);
+    return ok;
+#else
+    return tcg_out_ldst_slow_paths(s);
+#endif
+}
+
 /*
  * Allocate a new TCGLabelQemuLdst entry.
  */
@@ -131,8 +131,26 @@ static bool tcg_out_ldst_finalize(TCGContext *s);
 
 #define TCG_HIGHWATER 1024
 
+/*
+ * Backends that can branch anywhere in a region get the qemu_ld/st slow
+ * paths emitted out of line, in the last quarter of each region, so that
+ * the TB bodies in the rest of it are packed densely in the caches.
+ * A slow path is about 30 bytes on x86-64, no more than the fast path
+ * it belongs to, and only one guest instruction in three or four is a
+ * memory access, so a quarter is enough for the usual mix.  The size is
+ * not critical: whichever area fills up first ends the region, which
+ * only wastes the rest of the other one.
+ */
+#if defined(TCG_TARGET_NEED_LDST_LABELS) && defined(TCG_TARGET_COLD_CODE)
+#define TCG_COLD_CODE
+#define TCG_COLD_CODE_SHIFT 2
+#endif
+
 static TCGContext **tcg_ctxs;
 static unsigned int n_tcg_ctxs;
+#ifdef CONFIG_USER_ONLY
+static void tcg_ctx_pool_init(void);
+#endif
 TCGv_env cpu_env = 0;
 
 struct tcg_region_tree {
@@ -161,6 +179,10 @@ struct tcg_region_state {
     /* fields protected by the lock */
     size_t current; /* current region index */
     size_t agg_size_full; /* aggregate size of full regions */
+    size_t *order; /* allocated regions, oldest first */
+    size_t n_order;
+    size_t *evicted; /* regions to allocate again, see tcg_region_evict() */
+    size_t n_evicted;
 };
 
 static struct tcg_region_state region;
@@ -372,22 +394,23 @@ static void tcg_region_trees_init(void)
     }
 }
 
-static struct tcg_region_tree *tc_ptr_to_region_tree(void *p)
+static size_t tc_ptr_to_region_idx(const void *p)
 {
-    size_t region_idx;
-
     if (p < region.start_aligned) {
-        region_idx = 0;
+        return 0;
     } else {
         ptrdiff_t offset = p - region.start_aligned;
 
         if (offset > region.stride * (region.n - 1)) {
-            region_idx = region.n - 1;
-        } else {
-            region_idx = offset / region.stride;
+            return region.n - 1;
         }
+        return offset / region.stride;
     }
-    return region_trees + region_idx * tree_size;
+}
+
+static struct tcg_region_tree *tc_ptr_to_region_tree(void *p)
+{
+    return region_trees + tc_ptr_to_region_idx(p) * tree_size;
 }
 
 void tcg_tb_insert(TranslationBlock *tb)
@@ -517,16 +540,28 @@ static void tcg_region_assign(TCGContext *s, size_t curr_region)
     s->code_gen_buffer = start;
     s->code_gen_ptr = start;
     s->code_gen_buffer_size = end - start;
+#ifdef TCG_COLD_CODE
+    s->code_gen_cold_ptr = end - ((end - start) >> TCG_COLD_CODE_SHIFT);
+    s->code_gen_cold_highwater = end - TCG_HIGHWATER;
+    s->code_gen_highwater = s->code_gen_cold_ptr - TCG_HIGHWATER;
+#else
     s->code_gen_highwater = end - TCG_HIGHWATER;
+#endif
 }
 
 static bool tcg_region_alloc__locked(TCGContext *s)
 {
-    if (region.current == region.n) {
+    size_t curr_region;
+
+    if (region.current < region.n) {
+        curr_region = region.current++;
+    } else if (region.n_evicted) {
+        curr_region = region.evicted[--region.n_evicted];
+    } else {
         return true;
     }
-    tcg_region_assign(s, region.current);
-    region.current++;
+    tcg_region_assign(s, curr_region);
+    region.order[region.n_order++] = curr_region;
     return false;
 }
 
@@ -567,6 +602,8 @@ void tcg_region_reset_all(void)
     qemu_mutex_lock(&region.lock);
     region.current = 0;
     region.agg_size_full = 0;
+    region.n_order = 0;
+    region.n_evicted = 0;
 
     for (i = 0; i < n_ctxs; i++) {
         TCGContext *s = atomic_read(&tcg_ctxs[i]);
@@ -579,9 +616,105 @@ void tcg_region_reset_all(void)
     tcg_region_tree_reset_all();
 }
 
+/*
+ * Whether a full code_gen_buffer can be recycled one region at a time
+ * instead of being flushed, i.e. whether some region is not the current one
+ * of any context.
+ */
+bool tcg_region_can_evict(void)
+{
+    return region.n > atomic_read(&n_tcg_ctxs);
+}
+
+static bool tcg_region_in_use__locked(size_t curr_region)
+{
+    unsigned int n_ctxs = atomic_read(&n_tcg_ctxs);
+    unsigned int i;
+
+    for (i = 0; i < n_ctxs; i++) {
+        const TCGContext *s = atomic_read(&tcg_ctxs[i]);
+
+        if (tc_ptr_to_region_idx(s->code_gen_buffer) == curr_region) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Make room in a full code_gen_buffer by evicting the oldest region that no
+ * context is using.  @func is called on each TB of the region, and must
+ * remove it from every lookup structure and unlink the jumps into it;
+ * the region's TB tree is then reset, and the region is the next one to be
+ * allocated.  Regions are thus recycled in FIFO order, which keeps the most
+ * recently translated code.
+ *
+ * Returns false if the regions cannot be evicted, in which case the caller
+ * has to flush the whole buffer.
+ * Call from a safe-work context.
+ */
+bool tcg_region_evict(GTraverseFunc func, gpointer data)
+{
+    struct tcg_region_tree *rt;
+    void *start, *end;
+    size_t victim;
+    size_t i;
+
+    if (!tcg_region_can_evict()) {
+        return false;
+    }
+
+    qemu_mutex_lock(&region.lock);
+    /* a flush or an eviction may have made room in the meantime */
+    if (region.current < region.n || region.n_evicted) {
+        qemu_mutex_unlock(&region.lock);
+        return true;
+    }
+    for (i = 0; i < region.n_order; i++) {
+        if (!tcg_region_in_use__locked(region.order[i])) {
+            break;
+        }
+    }
+    if (i == region.n_order) {
+        qemu_mutex_unlock(&region.lock);
+        return false;
+    }
+    victim = region.order[i];
+    memmove(&region.order[i], &region.order[i + 1],
+            (region.n_order - i - 1) * sizeof(region.order[0]));
+    region.n_order--;
+
+    rt = region_trees + victim * tree_size;
+    qemu_mutex_lock(&rt->lock);
+    g_tree_foreach(rt->tree, func, data);
+    /* Increment the refcount first so that destroy acts as a reset */
+    g_tree_ref(rt->tree);
+    g_tree_destroy(rt->tree);
+    qemu_mutex_unlock(&rt->lock);
+
+    tcg_region_bounds(victim, &start, &end);
+    region.agg_size_full -= (end - start) - TCG_HIGHWATER;
+    region.evicted[region.n_evicted++] = victim;
+    qemu_mutex_unlock(&region.lock);
+    return true;
+}
+
 #ifdef CONFIG_USER_ONLY
+/*
+ * A few contexts translate for all threads, see tcg_ctx_acquire(); we split
+ * the buffer into a few regions of at least 1 MB, so that the contexts can
+ * generate code side by side, and tcg_region_evict() recycle the regions
+ * one at a time.
+ */
 static size_t tcg_n_regions(void)
 {
+    size_t i;
+
+    for (i = 8; i > 1; i--) {
+        if (tcg_init_ctx.code_gen_buffer_size / i >= 1024u * 1024) {
+            return i;
+        }
+    }
     return 1;
 }
 #else
@@ -633,17 +766,17 @@ static size_t tcg_n_regions(void)
  * must have been parsed before calling this function, since it calls
  * qemu_tcg_mttcg_enabled().
  *
- * In user-mode we use a single region.  Having multiple regions in user-mode
- * is not supported, because the number of vCPU threads (recall that each thread
+ * In user-mode, giving each vCPU thread its own context and region is not
+ * supported, because the number of vCPU threads (recall that each thread
  * spawned by the guest corresponds to a vCPU thread) is only bounded by the
  * OS, and usually this number is huge (tens of thousands is not uncommon).
  * Thus, given this large bound on the number of vCPU threads and the fact
  * that code_gen_buffer is allocated at compile-time, we cannot guarantee
  * that the availability of at least one region per vCPU thread.
  *
- * However, this user-mode limitation is unlikely to be a significant problem
- * in practice. Multi-threaded guests share most if not all of their translated
- * code, which makes parallel code generation less appealing than in softmmu.
+ * Instead, the threads borrow a context from a pool for each translation,
+ * see tcg_ctx_acquire().  The pool holds at most one context per host CPU,
+ * and no more than half the regions, so that the others can be evicted.
  */
 void tcg_region_init(void)
 {
@@ -694,15 +827,156 @@ void tcg_region_init(void)
     }
 
     tcg_region_trees_init();
+    region.order = g_new(size_t, region.n);
+    region.evicted = g_new(size_t, region.n);
 
-    /* In user-mode we support only one ctx, so do the initial allocation now */
 #ifdef CONFIG_USER_ONLY
-    {
-        bool err = tcg_region_initial_alloc__locked(tcg_ctx);
+    tcg_ctx_pool_init();
+#endif
+}
 
-        g_assert(!err);
+/*
+ * Copy the init context for another thread.  The pointers into its temps
+ * are relinked, and the memory pools are not shared.
+ */
+static TCGContext *tcg_ctx_clone(void)
+{
+    TCGContext *s = g_malloc(sizeof(*s));
+    unsigned int i, n;
+
+    *s = tcg_init_ctx;
+
+    /* Relink mem_base.  */
+    for (i = 0, n = tcg_init_ctx.nb_globals; i < n; ++i) {
+        if (tcg_init_ctx.temps[i].mem_base) {
+            ptrdiff_t b = tcg_init_ctx.temps[i].mem_base - tcg_init_ctx.temps;
+            tcg_debug_assert(b >= 0 && b < n);
+            s->temps[i].mem_base = &s->temps[b];
+        }
     }
-#endif
+
+    s->pool_first = s->pool_current = s->pool_first_large = NULL;
+    s->pool_cur = s->pool_end = NULL;
+    return s;
+}
+
+#ifdef CONFIG_USER_ONLY
+/*
+ * Translations only hold the read side of mmap_lock, so several threads may
+ * generate code at once.  Each one borrows a context from this pool for the
+ * duration of tb_gen_code().  The spare contexts are cloned at init time,
+ * while tcg_init_ctx is not translating yet, but only take a region and
+ * appear in tcg_ctxs[] once that many threads translate at the same time.
+ *
+ * Outside of translations tcg_ctx points to tcg_idle_ctx, which is in no
+ * pool and has no region: it only collects the statistics updated there,
+ * and holds the prologue and epilogue addresses common to all contexts.
+ * Generating code with it is a bug, caught by tcg_tb_alloc().
+ */
+#define TCG_MAX_USER_CTXS 8
+
+static TCGContext *tcg_idle_ctx;
+
+static struct {
+    QemuMutex lock;
+    QemuCond cond;
+    TCGContext *idle[TCG_MAX_USER_CTXS];
+    unsigned int n_idle;
+    TCGContext *spare[TCG_MAX_USER_CTXS];
+    unsigned int n_spare;
+} ctx_pool;
+
+static void tcg_ctx_pool_init(void)
+{
+    long host_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t n = MIN(region.n / 2, TCG_MAX_USER_CTXS);
+    bool err;
+
+    if (host_cpus > 0 && (size_t)host_cpus < n) {
+        n = host_cpus;
+    }
+
+    qemu_mutex_init(&ctx_pool.lock);
+    qemu_cond_init(&ctx_pool.cond);
+    err = tcg_region_initial_alloc__locked(&tcg_init_ctx);
+    g_assert(!err);
+    ctx_pool.idle[ctx_pool.n_idle++] = &tcg_init_ctx;
+    while (ctx_pool.n_spare + 1 < n) {
+        ctx_pool.spare[ctx_pool.n_spare++] = tcg_ctx_clone();
+    }
+
+    tcg_idle_ctx = tcg_ctx_clone();
+    tcg_idle_ctx->code_gen_buffer = NULL;
+    tcg_idle_ctx->code_gen_buffer_size = 0;
+    tcg_idle_ctx->code_gen_ptr = NULL;
+    tcg_idle_ctx->code_gen_highwater = NULL;
+    tcg_ctx = tcg_idle_ctx;
+}
+
+/* Give a spare context its first region.  Returns true on error. */
+static bool tcg_ctx_register(TCGContext *s)
+{
+    unsigned int n;
+    bool err;
+
+    qemu_mutex_lock(&region.lock);
+    err = tcg_region_initial_alloc__locked(s);
+    if (!err) {
+        n = n_tcg_ctxs;
+        atomic_set(&tcg_ctxs[n], s);
+        atomic_mb_set(&n_tcg_ctxs, n + 1);
+    }
+    qemu_mutex_unlock(&region.lock);
+    return err;
+}
+
+/*
+ * Point tcg_ctx to a context that no other thread is translating with,
+ * waiting for one if all are busy and no region is left for a spare.
+ *
+ * Call with the read side of mmap_lock held, and no page lock.  The lock
+ * order is mmap_lock, then ctx_pool.lock, then region.lock.  Waiting on
+ * ctx_pool.cond with the read side held cannot deadlock: a context is only
+ * held within tb_gen_code(), whose holder already has the read side, which
+ * it takes again without blocking, and never asks for the write side
+ * before giving the context back.  A writer waiting for mmap_lock waits
+ * for both threads, as for any two translations.
+ */
+void tcg_ctx_acquire(void)
+{
+    TCGContext *s;
+
+    qemu_mutex_lock(&ctx_pool.lock);
+    for (;;) {
+        if (ctx_pool.n_idle) {
+            s = ctx_pool.idle[--ctx_pool.n_idle];
+            break;
+        }
+        if (ctx_pool.n_spare &&
+            !tcg_ctx_register(ctx_pool.spare[ctx_pool.n_spare - 1])) {
+            s = ctx_pool.spare[--ctx_pool.n_spare];
+            break;
+        }
+        qemu_cond_wait(&ctx_pool.cond, &ctx_pool.lock);
+    }
+    qemu_mutex_unlock(&ctx_pool.lock);
+    tcg_ctx = s;
+}
+
+/*
+ * Give the context back to the pool, if the thread holds one, and point
+ * tcg_ctx to tcg_idle_ctx again.
+ */
+void tcg_ctx_release(void)
+{
+    if (tcg_ctx == tcg_idle_ctx) {
+        return;
+    }
+    qemu_mutex_lock(&ctx_pool.lock);
+    ctx_pool.idle[ctx_pool.n_idle++] = tcg_ctx;
+    qemu_cond_signal(&ctx_pool.cond);
+    qemu_mutex_unlock(&ctx_pool.lock);
+    tcg_ctx = tcg_idle_ctx;
 }
 
 /*
@@ -710,8 +984,19 @@ void tcg_region_init(void)
  * and registered the target's TCG globals) must register with this function
  * before initiating translation.
  *
- * In user-mode we just point tcg_ctx to tcg_init_ctx. See the documentation
- * of tcg_region_init() for the reasoning behind this.
+ * In user-mode we just point tcg_ctx to tcg_idle_ctx; translations borrow
+ * their context from the pool. See the documentation of tcg_region_init()
+ * for the reasoning behind this.
+ */
+void tcg_register_thread(void)
+{
+    tcg_ctx = tcg_idle_ctx;
+}
+#else
+/*
+ * All TCG threads except the parent (i.e. the one that called tcg_context_init
+ * and registered the target's TCG globals) must register with this function
+ * before initiating translation.
  *
  * In softmmu each caller registers its context in tcg_ctxs[]. Note that in
  * softmmu tcg_ctxs[] does not track tcg_ctx_init, since the initial context
@@ -720,29 +1005,12 @@ void tcg_region_init(void)
  * Not tracking tcg_init_ctx in tcg_ctxs[] in softmmu keeps code that iterates
  * over the array (e.g. tcg_code_size() the same for both softmmu and user-mode.
  */
-#ifdef CONFIG_USER_ONLY
-void tcg_register_thread(void)
-{
-    tcg_ctx = &tcg_init_ctx;
-}
-#else
 void tcg_register_thread(void)
 {
-    TCGContext *s = g_malloc(sizeof(*s));
-    unsigned int i, n;
+    TCGContext *s = tcg_ctx_clone();
+    unsigned int n;
     bool err;
 
-    *s = tcg_init_ctx;
-
-    /* Relink mem_base.  */
-    for (i = 0, n = tcg_init_ctx.nb_globals; i < n; ++i) {
-        if (tcg_init_ctx.temps[i].mem_base) {
-            ptrdiff_t b = tcg_init_ctx.temps[i].mem_base - tcg_init_ctx.temps;
-            tcg_debug_assert(b >= 0 && b < n);
-            s->temps[i].mem_base = &s->temps[b];
-        }
-    }
-
     /* Claim an entry in tcg_ctxs */
     n = atomic_fetch_inc(&n_tcg_ctxs);
     g_assert(n < max_cpus);
@@ -754,6 +1022,15 @@ void tcg_register_thread(void)
     g_assert(!err);
     qemu_mutex_unlock(&region.lock);
 }
+
+/* Each thread translates with its own context */
+void tcg_ctx_acquire(void)
+{
+}
+
+void tcg_ctx_release(void)
+{
+}
 #endif /* !CONFIG_USER_ONLY */
 
 /*
@@ -810,6 +1087,11 @@ size_t tcg_tb_phys_invalidate_count(void)
 
         total += atomic_read(&s->tb_phys_invalidate_count);
     }
+#ifdef CONFIG_USER_ONLY
+    if (tcg_idle_ctx) {
+        total += atomic_read(&tcg_idle_ctx->tb_phys_invalidate_count);
+    }
+#endif
     return total;
 }
 
@@ -946,13 +1228,13 @@ void tcg_context_init(TCGContext *s)
 
     tcg_ctx = s;
     /*
-     * In user-mode we simply share the init context among threads, since we
-     * use a single region. See the documentation tcg_region_init() for the
-     * reasoning behind this.
+     * In user-mode the init context is the first of a small pool. See the
+     * documentation tcg_region_init() for the reasoning behind this.
      * In softmmu we will have at most max_cpus TCG threads.
      */
 #ifdef CONFIG_USER_ONLY
-    tcg_ctxs = &tcg_ctx;
+    tcg_ctxs = g_new(TCGContext *, TCG_MAX_USER_CTXS);
+    tcg_ctxs[0] = s;
     n_tcg_ctxs = 1;
 #else
     tcg_ctxs = g_new(TCGContext *, max_cpus);
@@ -963,6 +1245,16 @@ void tcg_context_init(TCGContext *s)
     cpu_env = temp_tcgv_ptr(ts);
 }
 
+/* Whether the region has no room left for slow paths */
+static inline bool tcg_cold_code_full(TCGContext *s)
+{
+#ifdef TCG_COLD_CODE
+    return s->code_gen_cold_ptr > s->code_gen_cold_highwater;
+#else
+    return false;
+#endif
+}
+
 /*
  * Allocate TBs right before their corresponding translated code, making
  * sure that TBs and code are on different cache lines.
@@ -973,11 +1265,15 @@ TranslationBlock *tcg_tb_alloc(TCGContext *s)
     TranslationBlock *tb;
     void *next;
 
+#ifdef CONFIG_USER_ONLY
+    /* Translations must borrow a context, see tcg_ctx_acquire() */
+    g_assert(s != tcg_idle_ctx);
+#endif
  retry:
     tb = (void *)ROUND_UP((uintptr_t)s->code_gen_ptr, align);
     next = (void *)ROUND_UP((uintptr_t)(tb + 1), align);
 
-    if (unlikely(next > s->code_gen_highwater)) {
+    if (unlikely(next > s->code_gen_highwater || tcg_cold_code_full(s))) {
         if (tcg_region_alloc(s)) {
             return NULL;
         }
@@ -1254,6 +1550,9 @@ TCGv_vec tcg_temp_new_vec(TCGType type)
     case TCG_TYPE_V256:
         assert(TCG_TARGET_HAS_v256);
         break;
+    case TCG_TYPE_V512:
+        assert(TCG_TARGET_HAS_v512);
+        break;
     default:
         g_assert_not_reached();
     }
@@ -1353,7 +1652,8 @@ int tcg_check_temp_count(void)
 bool tcg_op_supported(TCGOpcode op)
 {
     const bool have_vec
-        = TCG_TARGET_HAS_v64 | TCG_TARGET_HAS_v128 | TCG_TARGET_HAS_v256;
+        = (TCG_TARGET_HAS_v64 | TCG_TARGET_HAS_v128 | TCG_TARGET_HAS_v256
+           | TCG_TARGET_HAS_v512);
 
     switch (op) {
     case INDEX_op_discard:
@@ -2249,6 +2549,8 @@ TCGOp *tcg_op_insert_after(TCGContext *s, TCGOp *old_op,
 
 #define TS_DEAD  1
 #define TS_MEM   2
+/* Register allocation: the value was evicted from its register.  */
+#define TS_SPILLED 4
 
 #define IS_DEAD_ARG(n)   (arg_life & (DEAD_ARG << (n)))
 #define NEED_SYNC_ARG(n) (arg_life & (SYNC_ARG << (n)))
@@ -2665,6 +2967,134 @@ static bool liveness_pass_2(TCGContext *s)
     return changes;
 }
 
+/* A use of a temp as an input operand.  The uses of each temp are chained
+   in op order from ts->state_ptr by next_use_analysis, and dropped by the
+   register allocator as it goes past them.  */
+typedef struct TCGTempUse {
+    struct TCGTempUse *next;
+    const TCGOp *op;
+    /* Number of ops from the use to the end of the TB */
+    int dist;
+    /* Registers the use would like the temp in, or 0 */
+    TCGRegSet regs;
+} TCGTempUse;
+
+/* Count the input operands of OP, and how many of them are passed to
+   a helper in registers.  */
+static int op_iargs(const TCGOp *op, int *nb_oargs, int *nb_regs)
+{
+    const TCGOpDef *def = &tcg_op_defs[op->opc];
+    int nb_iargs;
+
+    *nb_regs = 0;
+    if (op->opc == INDEX_op_call) {
+        *nb_oargs = TCGOP_CALLO(op);
+        nb_iargs = TCGOP_CALLI(op);
+        *nb_regs = MIN(ARRAY_SIZE(tcg_target_call_iarg_regs), nb_iargs);
+    } else {
+        *nb_oargs = def->nb_oargs;
+        nb_iargs = def->nb_iargs;
+    }
+    return nb_iargs;
+}
+
+/* Registers wanted by the next use of TS.  */
+static inline TCGRegSet temp_pref(TCGTemp *ts)
+{
+    TCGTempUse *use = ts->state_ptr;
+    return use ? use->regs : 0;
+}
+
+/* Distance from the next use of TS to the end of the TB: the smaller,
+   the further away the use.  -1 if TS is not used again.  */
+static inline int temp_next_dist(TCGTemp *ts)
+{
+    TCGTempUse *use = ts->state_ptr;
+    return use ? use->dist : -1;
+}
+
+/* Next-use analysis: record where each temp is used next, so that the
+   register allocator can evict the value needed furthest in the future,
+   and place an output where its next use wants it.  Must run after the
+   liveness passes, which use ts->state_ptr themselves.  */
+static void next_use_analysis(TCGContext *s)
+{
+    int nb_temps = s->nb_temps;
+    int dist = 0;
+    TCGOp *op;
+    int i;
+
+    for (i = 0; i < nb_temps; i++) {
+        s->temps[i].state = 0;
+        s->temps[i].state_ptr = NULL;
+    }
+
+    QTAILQ_FOREACH_REVERSE(op, &s->ops, TCGOpHead, link) {
+        const TCGOpDef *def = &tcg_op_defs[op->opc];
+        int nb_oargs, nb_regs;
+        int nb_iargs = op_iargs(op, &nb_oargs, &nb_regs);
+
+        for (i = nb_oargs; i < nb_oargs + nb_iargs; i++) {
+            TCGTemp *ts = arg_temp(op->args[i]);
+            TCGTempUse *use;
+            TCGRegSet regs = 0;
+
+            if (ts == NULL) {
+                continue;
+            }
+            if (op->opc == INDEX_op_call) {
+                if (i - nb_oargs < nb_regs) {
+                    tcg_regset_set_reg(regs,
+                        tcg_target_call_iarg_regs[i - nb_oargs]);
+                }
+            } else if (op->opc == INDEX_op_mov_i32
+                       || op->opc == INDEX_op_mov_i64
+                       || op->opc == INDEX_op_mov_vec) {
+                /* The source of a copy would rather be where the copy
+                   goes next.  */
+                regs = temp_pref(arg_temp(op->args[0]));
+            } else if (!(def->flags & TCG_OPF_NOT_PRESENT)
+                       && (def->args_ct[i].ct & TCG_CT_REG)) {
+                regs = def->args_ct[i].u.regs;
+            }
+
+            use = ts->state_ptr;
+            if (use && use->op == op) {
+                /* The same temp twice in one op.  */
+                use->regs &= regs;
+                continue;
+            }
+            use = tcg_malloc(sizeof(TCGTempUse));
+            use->next = ts->state_ptr;
+            use->op = op;
+            use->dist = dist;
+            use->regs = regs;
+            ts->state_ptr = use;
+        }
+        dist++;
+    }
+}
+
+/* The register allocator is about to process OP: drop its uses, so that
+   those left are the ones after OP.  */
+static void temp_uses_advance(const TCGOp *op)
+{
+    int nb_oargs, nb_regs, i;
+    int nb_iargs = op_iargs(op, &nb_oargs, &nb_regs);
+
+    for (i = nb_oargs; i < nb_oargs + nb_iargs; i++) {
+        TCGTemp *ts = arg_temp(op->args[i]);
+        TCGTempUse *use;
+
+        if (ts) {
+            use = ts->state_ptr;
+            if (use && use->op == op) {
+                ts->state_ptr = use->next;
+            }
+        }
+    }
+}
+
 #ifdef CONFIG_DEBUG_TCG
 static void dump_regs(TCGContext *s)
 {
@@ -2739,20 +3169,24 @@ static void check_regs(TCGContext *s)
 
 static void temp_allocate_frame(TCGContext *s, TCGTemp *ts)
 {
+    /* Vector temps need room for the whole vector, i.e. 8 << VECL bytes */
+    tcg_target_long size = (ts->base_type >= TCG_TYPE_V64
+                            ? 8 << (ts->base_type - TCG_TYPE_V64)
+                            : sizeof(tcg_target_long));
+
 #if !(defined(__sparc__) && TCG_TARGET_REG_BITS == 64)
     /* Sparc64 stack is accessed with offset of 2047 */
     s->current_frame_offset = (s->current_frame_offset +
                                (tcg_target_long)sizeof(tcg_target_long) - 1) &
         ~(sizeof(tcg_target_long) - 1);
 #endif
-    if (s->current_frame_offset + (tcg_target_long)sizeof(tcg_target_long) >
-        s->frame_end) {
+    if (s->current_frame_offset + size > s->frame_end) {
         tcg_abort();
     }
     ts->mem_offset = s->current_frame_offset;
     ts->mem_base = s->frame_temp;
     ts->mem_allocated = 1;
-    s->current_frame_offset += sizeof(tcg_target_long);
+    s->current_frame_offset += size;
 }
 
 static void temp_load(TCGContext *, TCGTemp *, TCGRegSet, TCGRegSet);
@@ -2767,6 +3201,9 @@ static void temp_free_or_dead(TCGContext *s, TCGTemp *ts, int free_or_dead)
     if (ts->val_type == TEMP_VAL_REG) {
         s->reg_to_temp[ts->reg] = NULL;
     }
+    if (free_or_dead > 0) {
+        ts->state &= ~TS_SPILLED;
+    }
     ts->val_type = (free_or_dead < 0
                     || ts->temp_local
                     || ts->temp_global
@@ -2835,33 +3272,66 @@ static void tcg_reg_free(TCGContext *s, TCGReg reg, TCGRegSet allocated_regs)
     }
 }
 
-/* Allocate a register belonging to reg1 & ~reg2 */
+/* Allocate a register belonging to reg1 & ~reg2, if possible a free one
+   in PREFERRED_REGS */
 static TCGReg tcg_reg_alloc(TCGContext *s, TCGRegSet desired_regs,
-                            TCGRegSet allocated_regs, bool rev)
+                            TCGRegSet allocated_regs,
+                            TCGRegSet preferred_regs, bool rev)
 {
     int i, n = ARRAY_SIZE(tcg_target_reg_alloc_order);
     const int *order;
     TCGReg reg;
     TCGRegSet reg_ct;
+    int best_reg, best_score;
 
     reg_ct = desired_regs & ~allocated_regs;
     order = rev ? indirect_reg_alloc_order : tcg_target_reg_alloc_order;
 
     /* first try free registers */
+    if (reg_ct & preferred_regs) {
+        for (i = 0; i < n; i++) {
+            reg = order[i];
+            if (tcg_regset_test_reg(reg_ct & preferred_regs, reg)
+                && s->reg_to_temp[reg] == NULL) {
+                return reg;
+            }
+        }
+    }
     for(i = 0; i < n; i++) {
         reg = order[i];
         if (tcg_regset_test_reg(reg_ct, reg) && s->reg_to_temp[reg] == NULL)
             return reg;
     }
 
-    /* XXX: do better spill choice */
+    /* Spill the value whose next use is the furthest away.  Among those
+       used equally far, prefer one already in memory, which needs no
+       store.  */
+    best_reg = -1;
+    best_score = INT_MAX;
     for(i = 0; i < n; i++) {
         reg = order[i];
         if (tcg_regset_test_reg(reg_ct, reg)) {
-            tcg_reg_free(s, reg, allocated_regs);
-            return reg;
+            TCGTemp *ts = s->reg_to_temp[reg];
+            int score = temp_next_dist(ts) * 2 + !ts->mem_coherent;
+            if (score < best_score) {
+                best_reg = reg;
+                best_score = score;
+            }
         }
     }
+    if (best_reg >= 0) {
+#ifdef CONFIG_PROFILER
+        /* Only count the evictions that store the value, not the
+           registers freed because a call clobbers them */
+        TCGTemp *ts = s->reg_to_temp[best_reg];
+        if (!ts->mem_coherent) {
+            atomic_set(&s->prof.spill_count, s->prof.spill_count + 1);
+        }
+        ts->state |= TS_SPILLED;
+#endif
+        tcg_reg_free(s, best_reg, allocated_regs);
+        return best_reg;
+    }
 
     tcg_abort();
 }
@@ -2877,14 +3347,22 @@ static void temp_load(TCGContext *s, TCGTemp *ts, TCGRegSet desired_regs,
     case TEMP_VAL_REG:
         return;
     case TEMP_VAL_CONST:
-        reg = tcg_reg_alloc(s, desired_regs, allocated_regs, ts->indirect_base);
+        reg = tcg_reg_alloc(s, desired_regs, allocated_regs,
+                            temp_pref(ts), ts->indirect_base);
         tcg_out_movi(s, ts->type, reg, ts->val);
         ts->mem_coherent = 0;
         break;
     case TEMP_VAL_MEM:
-        reg = tcg_reg_alloc(s, desired_regs, allocated_regs, ts->indirect_base);
+        reg = tcg_reg_alloc(s, desired_regs, allocated_regs,
+                            temp_pref(ts), ts->indirect_base);
         tcg_out_ld(s, ts->type, reg, ts->mem_base->reg, ts->mem_offset);
         ts->mem_coherent = 1;
+#ifdef CONFIG_PROFILER
+        if (ts->state & TS_SPILLED) {
+            atomic_set(&s->prof.reload_count, s->prof.reload_count + 1);
+            ts->state &= ~TS_SPILLED;
+        }
+#endif
         break;
     case TEMP_VAL_DEAD:
     default:
@@ -3042,7 +3520,8 @@ static void tcg_reg_alloc_mov(TCGContext *s, const TCGOp *op)
                    input one. */
                 tcg_regset_set_reg(allocated_regs, ts->reg);
                 ots->reg = tcg_reg_alloc(s, tcg_target_available_regs[otype],
-                                         allocated_regs, ots->indirect_base);
+                                         allocated_regs, temp_pref(ots),
+                                         ots->indirect_base);
             }
             tcg_out_mov(s, otype, ots->reg, ts->reg);
         }
@@ -3130,7 +3609,7 @@ static void tcg_reg_alloc_op(TCGContext *s, const TCGOp *op)
             /* allocate a new register matching the constraint 
                and move the temporary register into it */
             reg = tcg_reg_alloc(s, arg_ct->u.regs, i_allocated_regs,
-                                ts->indirect_base);
+                                0, ts->indirect_base);
             tcg_out_mov(s, ts->type, reg, ts->reg);
         }
         new_args[i] = reg;
@@ -3175,7 +3654,7 @@ static void tcg_reg_alloc_op(TCGContext *s, const TCGOp *op)
             } else if (arg_ct->ct & TCG_CT_NEWREG) {
                 reg = tcg_reg_alloc(s, arg_ct->u.regs,
                                     i_allocated_regs | o_allocated_regs,
-                                    ts->indirect_base);
+                                    temp_pref(ts), ts->indirect_base);
             } else {
                 /* if fixed register, we try to use it */
                 reg = ts->reg;
@@ -3184,7 +3663,7 @@ static void tcg_reg_alloc_op(TCGContext *s, const TCGOp *op)
                     goto oarg_end;
                 }
                 reg = tcg_reg_alloc(s, arg_ct->u.regs, o_allocated_regs,
-                                    ts->indirect_base);
+                                    temp_pref(ts), ts->indirect_base);
             }
             tcg_regset_set_reg(o_allocated_regs, reg);
             /* if a fixed register is used, then a move will be done afterwards */
@@ -3378,6 +3857,38 @@ static void tcg_reg_alloc_call(TCGContext *s, TCGOp *op)
         }                                                               \
     } while (0)
 
+static inline void tcg_profile_add(TCGProfile *prof, const TCGProfile *orig,
+                                   bool counters, bool table)
+{
+    if (counters) {
+        PROF_ADD(prof, orig, tb_count1);
+        PROF_ADD(prof, orig, tb_count);
+        PROF_ADD(prof, orig, op_count);
+        PROF_MAX(prof, orig, op_count_max);
+        PROF_ADD(prof, orig, temp_count);
+        PROF_MAX(prof, orig, temp_count_max);
+        PROF_ADD(prof, orig, del_op_count);
+        PROF_ADD(prof, orig, code_in_len);
+        PROF_ADD(prof, orig, code_out_len);
+        PROF_ADD(prof, orig, search_out_len);
+        PROF_ADD(prof, orig, interm_time);
+        PROF_ADD(prof, orig, code_time);
+        PROF_ADD(prof, orig, la_time);
+        PROF_ADD(prof, orig, opt_time);
+        PROF_ADD(prof, orig, restore_count);
+        PROF_ADD(prof, orig, restore_time);
+        PROF_ADD(prof, orig, spill_count);
+        PROF_ADD(prof, orig, reload_count);
+    }
+    if (table) {
+        int i;
+
+        for (i = 0; i < NB_OPS; i++) {
+            PROF_ADD(prof, orig, table_op_count[i]);
+        }
+    }
+}
+
 /* Pass in a zero'ed @prof */
 static inline
 void tcg_profile_snapshot(TCGProfile *prof, bool counters, bool table)
@@ -3387,34 +3898,15 @@ void tcg_profile_snapshot(TCGProfile *prof, bool counters, bool table)
 
     for (i = 0; i < n_ctxs; i++) {
         TCGContext *s = atomic_read(&tcg_ctxs[i]);
-        const TCGProfile *orig = &s->prof;
-
-        if (counters) {
-            PROF_ADD(prof, orig, tb_count1);
-            PROF_ADD(prof, orig, tb_count);
-            PROF_ADD(prof, orig, op_count);
-            PROF_MAX(prof, orig, op_count_max);
-            PROF_ADD(prof, orig, temp_count);
-            PROF_MAX(prof, orig, temp_count_max);
-            PROF_ADD(prof, orig, del_op_count);
-            PROF_ADD(prof, orig, code_in_len);
-            PROF_ADD(prof, orig, code_out_len);
-            PROF_ADD(prof, orig, search_out_len);
-            PROF_ADD(prof, orig, interm_time);
-            PROF_ADD(prof, orig, code_time);
-            PROF_ADD(prof, orig, la_time);
-            PROF_ADD(prof, orig, opt_time);
-            PROF_ADD(prof, orig, restore_count);
-            PROF_ADD(prof, orig, restore_time);
-        }
-        if (table) {
-            int i;
-
-            for (i = 0; i < NB_OPS; i++) {
-                PROF_ADD(prof, orig, table_op_count[i]);
-            }
-        }
+
+        tcg_profile_add(prof, &s->prof, counters, table);
+    }
+#ifdef CONFIG_USER_ONLY
+    /* The state restores are counted outside of translations */
+    if (tcg_idle_ctx) {
+        tcg_profile_add(prof, &tcg_idle_ctx->prof, counters, table);
     }
+#endif
 }
 
 #undef PROF_ADD
@@ -3493,7 +3985,9 @@ int tcg_gen_code(TCGContext *s, TranslationBlock *tb)
 #endif
 
 #ifdef USE_TCG_OPTIMIZATIONS
-    tcg_optimize(s);
+    if (!(tb_cflags(tb) & CF_NOOPT)) {
+        tcg_optimize(s);
+    }
 #endif
 
 #ifdef CONFIG_PROFILER
@@ -3536,10 +4030,12 @@ int tcg_gen_code(TCGContext *s, TranslationBlock *tb)
     }
 #endif
 
+    next_use_analysis(s);
     tcg_reg_alloc_start(s);
 
     s->code_buf = tb->tc.ptr;
     s->code_ptr = tb->tc.ptr;
+    s->tb_cold_size = 0;
 
 #ifdef TCG_TARGET_NEED_LDST_LABELS
     QSIMPLEQ_INIT(&s->ldst_labels);
@@ -3556,6 +4052,8 @@ int tcg_gen_code(TCGContext *s, TranslationBlock *tb)
         atomic_set(&prof->table_op_count[opc], prof->table_op_count[opc] + 1);
 #endif
 
+        temp_uses_advance(op);
+
         switch (opc) {
         case INDEX_op_mov_i32:
         case INDEX_op_mov_i64:
@@ -3663,6 +4161,10 @@ void tcg_dump_info(FILE *f, fprintf_function cpu_fprintf)
                 (double)s->del_op_count / tb_div_count);
     cpu_fprintf(f, "avg temps/TB        %0.2f max=%d\n",
                 (double)s->temp_count / tb_div_count, s->temp_count_max);
+    cpu_fprintf(f, "spills/TB           %0.2f\n",
+                (double)s->spill_count / tb_div_count);
+    cpu_fprintf(f, "reloads/TB          %0.2f\n",
+                (double)s->reload_count / tb_div_count);
     cpu_fprintf(f, "avg host code/TB    %0.1f\n",
                 (double)s->code_out_len / tb_div_count);
     cpu_fprintf(f, "avg search data/TB  %0.1f\n",
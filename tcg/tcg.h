@@ -50,7 +50,14 @@
  * (N = number of input arguments + output arguments).  */
 #define MAX_OPC_PARAM (4 + (MAX_OPC_PARAM_PER_ARG * MAX_OPC_PARAM_ARGS))
 
+/* The spill slots of the TCG temps.  A 512-bit vector temp takes 64 bytes
+   of them, so a backend that may use such vectors gets 64 of those slots
+   rather than 16.  */
+#ifdef TCG_TARGET_HAS_v512
+#define CPU_TEMP_BUF_NLONGS 512
+#else
 #define CPU_TEMP_BUF_NLONGS 128
+#endif
 
 /* Default target word size to pointer size.  */
 #ifndef TCG_TARGET_REG_BITS
@@ -172,7 +179,8 @@ typedef uint64_t TCGRegSet;
 
 #if !defined(TCG_TARGET_HAS_v64) \
     && !defined(TCG_TARGET_HAS_v128) \
-    && !defined(TCG_TARGET_HAS_v256)
+    && !defined(TCG_TARGET_HAS_v256) \
+    && !defined(TCG_TARGET_HAS_v512)
 #define TCG_TARGET_MAYBE_vec            0
 #define TCG_TARGET_HAS_neg_vec          0
 #define TCG_TARGET_HAS_not_vec          0
@@ -194,6 +202,9 @@ typedef uint64_t TCGRegSet;
 #ifndef TCG_TARGET_HAS_v256
 #define TCG_TARGET_HAS_v256             0
 #endif
+#ifndef TCG_TARGET_HAS_v512
+#define TCG_TARGET_HAS_v512             0
+#endif
 
 #ifndef TARGET_INSN_START_EXTRA_WORDS
 # define TARGET_INSN_START_WORDS 1
@@ -275,6 +286,7 @@ typedef enum TCGType {
     TCG_TYPE_V64,
     TCG_TYPE_V128,
     TCG_TYPE_V256,
+    TCG_TYPE_V512,
 
     TCG_TYPE_COUNT, /* number of different types */
 
@@ -645,6 +657,8 @@ typedef struct TCGProfile {
     int64_t opt_time;
     int64_t restore_count;
     int64_t restore_time;
+    int64_t spill_count;
+    int64_t reload_count;
     int64_t table_op_count[NB_OPS];
 } TCGProfile;
 
@@ -695,6 +709,14 @@ struct TCGContext {
     /* Threshold to flush the translated code buffer.  */
     void *code_gen_highwater;
 
+    /* Out-of-line slow paths of the current region, if the backend has
+       TCG_TARGET_COLD_CODE.  */
+    void *code_gen_cold_ptr;
+    void *code_gen_cold_highwater;
+    /* Slow paths of the TB last generated, for the logs and perf */
+    void *tb_cold_ptr;
+    size_t tb_cold_size;
+
     size_t tb_phys_invalidate_count;
 
     /* Track which vCPU triggers events */
@@ -866,6 +888,8 @@ TranslationBlock *tcg_tb_alloc(TCGContext *s);
 
 void tcg_region_init(void);
 void tcg_region_reset_all(void);
+bool tcg_region_can_evict(void);
+bool tcg_region_evict(GTraverseFunc func, gpointer data);
 
 size_t tcg_code_size(void);
 size_t tcg_code_capacity(void);
@@ -898,6 +922,8 @@ static inline void *tcg_malloc(int size)
 
 void tcg_context_init(TCGContext *s);
 void tcg_register_thread(void);
+void tcg_ctx_acquire(void);
+void tcg_ctx_release(void);
 void tcg_prologue_init(TCGContext *s);
 void tcg_func_start(TCGContext *s);
 
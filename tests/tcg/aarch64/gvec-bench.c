@@ -0,0 +1,81 @@
+/*
+ * Throughput of SVE integer operations on whole vectors.  QEMU expands
+ * the unpredicated forms with the generic vector (gvec) code, so this
+ * measures how well the host backend implements them, e.g. with 256 or
+ * 512-bit host vectors.  Run with -cpu max; the vector length is printed.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+#define ITERATIONS 1000000
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint64_t vector_bytes(void)
+{
+    uint64_t vl;
+
+    asm("rdvl %0, #1" : "=r"(vl));
+    return vl;
+}
+
+/* Four dependent operations per iteration, on registers only */
+#define BENCH(name, insn)                                               \
+    static double bench_##name(void)                                    \
+    {                                                                   \
+        uint64_t n = ITERATIONS;                                        \
+        double start = now();                                           \
+                                                                        \
+        asm volatile("1:\n\t"                                           \
+                     insn "\n\t" insn "\n\t" insn "\n\t" insn "\n\t"    \
+                     "subs %0, %0, #1\n\t"                              \
+                     "b.ne 1b"                                          \
+                     : "+r"(n) : : "v0", "v1", "cc");                   \
+        return now() - start;                                           \
+    }
+
+BENCH(add_b, "add z0.b, z0.b, z1.b")
+BENCH(sub_d, "sub z0.d, z0.d, z1.d")
+BENCH(eor, "eor z0.d, z0.d, z1.d")
+BENCH(bic, "bic z0.d, z0.d, z1.d")
+BENCH(lsl_s, "lsl z0.s, z0.s, #3")
+BENCH(asr_d, "asr z0.d, z0.d, #7")
+
+static const struct {
+    const char *name;
+    double (*fn)(void);
+} benches[] = {
+    { "add.b", bench_add_b },
+    { "sub.d", bench_sub_d },
+    { "eor", bench_eor },
+    { "bic", bench_bic },
+    { "lsl.s #3", bench_lsl_s },
+    { "asr.d #7", bench_asr_d },
+};
+
+int main(void)
+{
+    uint64_t vl = vector_bytes();
+    double bytes = 4.0 * ITERATIONS * vl;
+    int i;
+
+    printf("SVE vector length: %u bits\n", (unsigned)(vl * 8));
+    for (i = 0; i < sizeof(benches) / sizeof(benches[0]); i++) {
+        double secs = benches[i].fn();
+
+        printf("%-10s %8.1f Mops/s %8.2f GB/s\n", benches[i].name,
+               4.0 * ITERATIONS / secs / 1e6, bytes / secs / 1e9);
+    }
+    return 0;
+}
@@ -0,0 +1,68 @@
+#!/usr/bin/env python3
+#
+# Turn the bench.raw records appended by the Hexagon DSP kernel benchmarks
+# (see bench.c) into a JSON report
+#
+# This work is licensed under the terms of the GNU GPL, version 2 or later.
+# See the COPYING file in the top-level directory.
+
+import argparse
+import json
+import struct
+import sys
+
+# name, then (ns lo, ns hi, packets lo, packets hi, TBs) before the cold
+# run, between the runs and after the warm run
+RECORD_FMT = "=16s" + "IIIII" * 3
+
+
+def _snapshots(fields):
+    for i in range(3):
+        ns_lo, ns_hi, pkt_lo, pkt_hi, tbs = fields[i * 5:i * 5 + 5]
+        yield (ns_hi << 32 | ns_lo, pkt_hi << 32 | pkt_lo, tbs)
+
+
+def parse(path):
+    size = struct.calcsize(RECORD_FMT)
+    with open(path, "rb") as f:
+        data = f.read()
+    for pos in range(0, len(data) - size + 1, size):
+        fields = struct.unpack_from(RECORD_FMT, data, pos)
+        name = fields[0].split(b"\0", 1)[0].decode()
+        start, cold, warm = _snapshots(fields[1:])
+        cold_ns = cold[0] - start[0]
+        warm_ns = warm[0] - cold[0]
+        packets = warm[1] - cold[1]
+        yield {
+            "name": name,
+            "packets": packets,
+            "warm_ns": warm_ns,
+            "cold_ns": cold_ns,
+            # Both runs execute the same packets, so the difference is the
+            # cost of translating the kernel
+            "translation_ns": max(cold_ns - warm_ns, 0),
+            "tbs_translated": cold[2] - start[2],
+            "packets_per_second": packets * 1e9 / warm_ns if warm_ns else 0,
+            "mips": packets / (warm_ns / 1e3) if warm_ns else 0,
+            "ns_per_packet": float(warm_ns) / packets if packets else 0,
+        }
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Summarize Hexagon DSP kernel benchmark results as JSON")
+    parser.add_argument("raw", help="bench.raw written by the benchmarks")
+    parser.add_argument("-o", "--output", help="write the JSON here")
+    args = parser.parse_args()
+
+    report = {"benchmarks": list(parse(args.raw))}
+    text = json.dumps(report, indent=2, sort_keys=True) + "\n"
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(text)
+    else:
+        sys.stdout.write(text)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,104 @@
+/*
+ * Purpose: driver for the DSP kernel benchmarks.  Each bench_*.s provides
+ * bench_kernel() and bench_name; the kernel runs once cold, so that the
+ * time includes translating it, then once warm, from the code cache.
+ * Timestamps, packet and TB counts around both runs are appended to
+ * bench.raw, which bench-report.py turns into the JSON report.
+ */
+
+#include <stdint.h>
+
+#define SYS_OPEN      0x01
+#define SYS_CLOSE     0x02
+#define SYS_WRITE     0x05
+#define SYS_ELAPSED   0x30
+#define SYS_EXECSTATS 0x190
+
+/* Mode index of "ab" in the semihosting fopen() mode table */
+#define OPEN_APPEND_BINARY 9
+
+struct snapshot {
+    uint32_t ns[2];
+    uint32_t packets[2];
+    uint32_t tbs;
+};
+
+struct record {
+    char name[16];
+    struct snapshot snap[3];
+};
+
+extern void init(void);
+extern void pass(void);
+extern void fail(void);
+extern void bench_kernel(void);
+extern const char bench_name[];
+
+static const char raw_file[] = "bench.raw";
+
+static int semihost(int nr, void *args)
+{
+    register int r0 asm("r0") = nr;
+    register void *r1 asm("r1") = args;
+
+    asm volatile("{ trap0(#0) }"
+                 : "+r"(r0)
+                 : "r"(r1)
+                 : "memory");
+    return r0;
+}
+
+static void snapshot(struct snapshot *s)
+{
+    uint32_t stats[3];
+
+    semihost(SYS_ELAPSED, s->ns);
+    semihost(SYS_EXECSTATS, stats);
+    s->packets[0] = stats[0];
+    s->packets[1] = stats[1];
+    s->tbs = stats[2];
+}
+
+static void save(struct record *rec)
+{
+    uint32_t args[3];
+    int fd;
+
+    args[0] = (uint32_t)raw_file;
+    args[1] = OPEN_APPEND_BINARY;
+    args[2] = sizeof(raw_file) - 1;
+    fd = semihost(SYS_OPEN, args);
+    if (fd == -1) {
+        fail();
+    }
+
+    args[0] = fd;
+    args[1] = (uint32_t)rec;
+    args[2] = sizeof(*rec);
+    if (semihost(SYS_WRITE, args) != 0) {
+        fail();
+    }
+
+    args[0] = fd;
+    semihost(SYS_CLOSE, args);
+}
+
+void _start(void)
+{
+    struct record rec = { { 0 } };
+    int i;
+
+    init();
+    for (i = 0; i < sizeof(rec.name) - 1 && bench_name[i]; i++) {
+        rec.name[i] = bench_name[i];
+    }
+
+    snapshot(&rec.snap[0]);
+    bench_kernel();
+    snapshot(&rec.snap[1]);
+    bench_kernel();
+    snapshot(&rec.snap[2]);
+
+    save(&rec);
+    pass();
+}
@@ -0,0 +1,97 @@
+# Purpose: benchmark kernel, table-driven CRC-32 over 4 KiB, repeated 500
+# times; the table is built bitwise with tstbit/mux first
+
+    .text
+    .globl bench_kernel
+bench_kernel:
+    {
+        r3 = ##crc_table
+        r4 = #0
+        r6 = ##0xedb88320
+    }
+    {
+        loop1(.Lcrc_entry, #256)
+    }
+.Lcrc_entry:
+    {
+        r5 = r4
+        loop0(.Lcrc_bit, #8)
+    }
+.Lcrc_bit:
+    {
+        p0 = tstbit(r5, #0)
+        r5 = lsr(r5, #1)
+    }
+    {
+        r7 = xor(r5, r6)
+    }
+    {
+        r5 = mux(p0, r7, r5)
+    }:endloop0
+    {
+        memw(r3++#4) = r5
+        r4 = add(r4, #1)
+    }:endloop1
+
+    # Fill the data with a pattern
+    {
+        r0 = ##crc_data
+        r1 = ##0x01234567
+        r2 = ##0x9e3779b9
+    }
+    {
+        loop0(.Lcrc_fill, #1024)
+    }
+.Lcrc_fill:
+    {
+        memw(r0++#4) = r1
+        r1 = add(r1, r2)
+    }:endloop0
+
+    {
+        r10 = #500
+        r3 = ##crc_table
+        r4 = #4096
+    }
+.Lcrc_rep:
+    {
+        r0 = ##crc_data
+        r2 = #-1
+        loop0(.Lcrc_byte, r4)
+    }
+.Lcrc_byte:
+    {
+        r1 = memub(r0++#1)
+    }
+    {
+        r1 = xor(r1, r2)
+        r2 = lsr(r2, #8)
+    }
+    {
+        r1 = and(r1, #255)
+    }
+    {
+        r1 = memw(r3+r1<<#2)
+    }
+    {
+        r2 = xor(r2, r1)
+    }:endloop0
+    {
+        r2 = not(r2)
+        r10 = add(r10, #-1)
+        p0 = cmp.gt(r10, #1)
+        if (p0.new) jump:t .Lcrc_rep
+    }
+    {
+        jumpr r31
+    }
+
+    .data
+    .globl bench_name
+bench_name:
+    .string "crc32"
+    .p2align 3
+crc_table:
+    .space 1024
+crc_data:
+    .space 4096
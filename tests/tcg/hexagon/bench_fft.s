@@ -0,0 +1,175 @@
+# Purpose: benchmark kernel, radix-2 decimation-in-time FFT over 256
+# complex 16-bit points, with a bit-reversed input copy, repeated 200 times
+
+    .text
+    .globl bench_kernel
+bench_kernel:
+    # Fill the input with a pattern, real part in the low halfword
+    {
+        r0 = ##fft_input
+        r1 = #0
+        r2 = ##0x00250013
+    }
+    {
+        loop0(.Lfft_fill, #256)
+    }
+.Lfft_fill:
+    {
+        memw(r0++#4) = r1
+        r1 = add(r1, r2)
+    }:endloop0
+
+    {
+        r10 = #200
+    }
+.Lfft_rep:
+    # Bit-reversed copy.  fft_input is 64 KiB aligned, so the low halfword
+    # of r1 is the reversed byte offset; 1 << 6 walks 256 words.
+    {
+        r0 = #64
+        r1 = ##fft_input
+        r2 = ##fft_work
+    }
+    {
+        m0 = r0
+        loop0(.Lfft_brev, #256)
+    }
+.Lfft_brev:
+    {
+        r3 = memw(r1++m0:brev)
+    }
+    {
+        memw(r2++#4) = r3
+    }:endloop0
+
+    # r12: butterfly span in bytes, r13: twiddle stride in bytes,
+    # r14: number of groups in the stage
+    {
+        r12 = #4
+        r13 = #512
+        r14 = #128
+    }
+.Lfft_stage:
+    {
+        r6 = ##fft_work
+        loop1(.Lfft_group, r14)
+    }
+.Lfft_group:
+    {
+        r7 = add(r6, r12)
+        r8 = ##fft_twiddle
+        r9 = lsr(r12, #2)
+    }
+    {
+        loop0(.Lfft_bfly, r9)
+    }
+.Lfft_bfly:
+    {
+        r1 = memw(r7+#0)
+        r2 = memw(r8+#0)
+        r8 = add(r8, r13)
+    }
+    {
+        r3 = sxth(r1)
+        r4 = asrh(r1)
+        r5 = sxth(r2)
+        r15 = asrh(r2)
+    }
+    {
+        r0 = memw(r6+#0)
+        r11 = mpyi(r3, r5)
+        r28 = mpyi(r4, r15)
+    }
+    {
+        r3 = mpyi(r3, r15)
+        r4 = mpyi(r4, r5)
+        r11 = sub(r11, r28)
+    }
+    {
+        r3 = add(r3, r4)
+        r11 = asr(r11, #15)
+    }
+    {
+        r3 = asr(r3, #15)
+        r4 = sxth(r0)
+        r5 = asrh(r0)
+    }
+    {
+        r15 = add(r4, r11)
+        r4 = sub(r4, r11)
+        r28 = add(r5, r3)
+        r5 = sub(r5, r3)
+    }
+    {
+        r0 = combine(r28.L, r15.L)
+        r1 = combine(r5.L, r4.L)
+    }
+    {
+        memw(r6++#4) = r0
+        memw(r7++#4) = r1
+    }:endloop0
+    {
+        r6 = r7
+    }:endloop1
+    {
+        r12 = asl(r12, #1)
+        r13 = lsr(r13, #1)
+        r14 = lsr(r14, #1)
+    }
+    {
+        p0 = cmp.eq(r14, #0)
+        if (!p0.new) jump:t .Lfft_stage
+    }
+
+    {
+        r10 = add(r10, #-1)
+        p0 = cmp.gt(r10, #1)
+        if (p0.new) jump:t .Lfft_rep
+    }
+    {
+        jumpr r31
+    }
+
+    .data
+    .globl bench_name
+bench_name:
+    .string "fft"
+    .p2align 2
+fft_twiddle:
+    .word 0x00007fff, 0xfcdc7ff5, 0xf9b87fd8, 0xf6967fa6
+    .word 0xf3747f61, 0xf0557f09, 0xed387e9c, 0xea1e7e1d
+    .word 0xe7077d89, 0xe3f57ce3, 0xe0e67c29, 0xdddd7b5c
+    .word 0xdad87a7c, 0xd7da7989, 0xd4e17884, 0xd1ef776b
+    .word 0xcf057641, 0xcc217504, 0xc94673b5, 0xc6747254
+    .word 0xc3aa70e2, 0xc0e96f5e, 0xbe326dc9, 0xbb866c23
+    .word 0xb8e46a6d, 0xb64c68a6, 0xb3c166cf, 0xb14164e8
+    .word 0xaecd62f1, 0xac6560eb, 0xaa0b5ed7, 0xa7be5cb3
+    .word 0xa57e5a82, 0xa34d5842, 0xa12955f5, 0x9f15539b
+    .word 0x9d0f5133, 0x9b184ebf, 0x99314c3f, 0x975a49b4
+    .word 0x9593471c, 0x93dd447a, 0x923741ce, 0x90a23f17
+    .word 0x8f1e3c56, 0x8dac398c, 0x8c4b36ba, 0x8afc33df
+    .word 0x89bf30fb, 0x88952e11, 0x877c2b1f, 0x86772826
+    .word 0x85842528, 0x84a42223, 0x83d71f1a, 0x831d1c0b
+    .word 0x827718f9, 0x81e315e2, 0x816412c8, 0x80f70fab
+    .word 0x809f0c8c, 0x805a096a, 0x80280648, 0x800b0324
+    .word 0x80010000, 0x800bfcdc, 0x8028f9b8, 0x805af696
+    .word 0x809ff374, 0x80f7f055, 0x8164ed38, 0x81e3ea1e
+    .word 0x8277e707, 0x831de3f5, 0x83d7e0e6, 0x84a4dddd
+    .word 0x8584dad8, 0x8677d7da, 0x877cd4e1, 0x8895d1ef
+    .word 0x89bfcf05, 0x8afccc21, 0x8c4bc946, 0x8dacc674
+    .word 0x8f1ec3aa, 0x90a2c0e9, 0x9237be32, 0x93ddbb86
+    .word 0x9593b8e4, 0x975ab64c, 0x9931b3c1, 0x9b18b141
+    .word 0x9d0faecd, 0x9f15ac65, 0xa129aa0b, 0xa34da7be
+    .word 0xa57ea57e, 0xa7bea34d, 0xaa0ba129, 0xac659f15
+    .word 0xaecd9d0f, 0xb1419b18, 0xb3c19931, 0xb64c975a
+    .word 0xb8e49593, 0xbb8693dd, 0xbe329237, 0xc0e990a2
+    .word 0xc3aa8f1e, 0xc6748dac, 0xc9468c4b, 0xcc218afc
+    .word 0xcf0589bf, 0xd1ef8895, 0xd4e1877c, 0xd7da8677
+    .word 0xdad88584, 0xdddd84a4, 0xe0e683d7, 0xe3f5831d
+    .word 0xe7078277, 0xea1e81e3, 0xed388164, 0xf05580f7
+    .word 0xf374809f, 0xf696805a, 0xf9b88028, 0xfcdc800b
+fft_work:
+    .space 1024
+    .p2align 16
+fft_input:
+    .space 1024
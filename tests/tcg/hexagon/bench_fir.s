@@ -0,0 +1,88 @@
+# Purpose: benchmark kernel, 64-tap FIR filter over 1024 16-bit samples,
+# repeated 100 times
+
+    .text
+    .globl bench_kernel
+bench_kernel:
+    # Fill the input with a ramp and the taps with small coefficients
+    {
+        r4 = #1088
+        r2 = ##fir_input
+        r3 = #0
+    }
+    {
+        loop0(.Lfir_fill, r4)
+    }
+.Lfir_fill:
+    {
+        r5 = and(r3, #511)
+        r3 = add(r3, #37)
+    }
+    {
+        memh(r2++#2) = r5
+    }:endloop0
+    {
+        r2 = ##fir_coef
+        r3 = #1
+        loop0(.Lfir_coef, #64)
+    }
+.Lfir_coef:
+    {
+        memh(r2++#2) = r3
+        r3 = add(r3, #3)
+    }:endloop0
+
+    {
+        r10 = #100
+    }
+.Lfir_rep:
+    {
+        r6 = ##fir_input
+        r7 = ##fir_output
+        r4 = #1024
+    }
+    {
+        loop1(.Lfir_sample, r4)
+    }
+.Lfir_sample:
+    {
+        r2 = ##fir_coef
+        r3 = r6
+        r8 = #0
+        loop0(.Lfir_tap, #64)
+    }
+.Lfir_tap:
+    {
+        r0 = memh(r2++#2)
+        r1 = memh(r3++#2)
+    }
+    {
+        r8 += mpyi(r0, r1)
+    }:endloop0
+    {
+        r8 = asr(r8, #15)
+        r6 = add(r6, #2)
+    }
+    {
+        memh(r7++#2) = r8
+    }:endloop1
+    {
+        r10 = add(r10, #-1)
+        p0 = cmp.gt(r10, #1)
+        if (p0.new) jump:t .Lfir_rep
+    }
+    {
+        jumpr r31
+    }
+
+    .data
+    .globl bench_name
+bench_name:
+    .string "fir"
+    .p2align 3
+fir_coef:
+    .space 128
+fir_input:
+    .space 2176
+fir_output:
+    .space 2048
@@ -0,0 +1,44 @@
+# Purpose: benchmark kernel, software-pipelined 4 KiB memcpy with 64-bit
+# post-increment loads and stores, repeated 2000 times
+
+    .text
+    .globl bench_kernel
+bench_kernel:
+    {
+        r10 = #2000
+    }
+.Lmemcpy_rep:
+    {
+        r0 = ##memcpy_src
+        r1 = ##memcpy_dst
+    }
+    {
+        r3:2 = memd(r0++#8)
+        loop0(.Lmemcpy_loop, #511)
+    }
+.Lmemcpy_loop:
+    {
+        memd(r1++#8) = r3:2
+        r3:2 = memd(r0++#8)
+    }:endloop0
+    {
+        memd(r1++#8) = r3:2
+    }
+    {
+        r10 = add(r10, #-1)
+        p0 = cmp.gt(r10, #1)
+        if (p0.new) jump:t .Lmemcpy_rep
+    }
+    {
+        jumpr r31
+    }
+
+    .data
+    .globl bench_name
+bench_name:
+    .string "memcpy"
+    .p2align 3
+memcpy_src:
+    .space 4096
+memcpy_dst:
+    .space 4096
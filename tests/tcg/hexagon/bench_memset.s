@@ -0,0 +1,37 @@
+# Purpose: benchmark kernel, 4 KiB memset with 64-bit post-increment
+# stores, repeated 2000 times with a different fill value each time
+
+    .text
+    .globl bench_kernel
+bench_kernel:
+    {
+        r10 = #2000
+        r4 = #0
+    }
+.Lmemset_rep:
+    {
+        r0 = ##memset_dst
+        r3:2 = combine(r4, r4)
+        loop0(.Lmemset_loop, #512)
+    }
+.Lmemset_loop:
+    {
+        memd(r0++#8) = r3:2
+    }:endloop0
+    {
+        r4 = add(r4, #1)
+        r10 = add(r10, #-1)
+        p0 = cmp.gt(r10, #1)
+        if (p0.new) jump:t .Lmemset_rep
+    }
+    {
+        jumpr r31
+    }
+
+    .data
+    .globl bench_name
+bench_name:
+    .string "memset"
+    .p2align 3
+memset_dst:
+    .space 4096
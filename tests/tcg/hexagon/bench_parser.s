@@ -0,0 +1,130 @@
+# Purpose: benchmark kernel, branchy byte-at-a-time parser that classifies
+# 4 KiB of text and sums the decimal numbers in it, repeated 200 times
+
+    .text
+    .globl bench_kernel
+bench_kernel:
+    # Generate the text from an LCG indexing a 16-character alphabet
+    {
+        r0 = ##parse_text
+        r1 = #1
+        r8 = ##1103515245
+    }
+    {
+        r9 = ##parse_alphabet
+        r4 = #4096
+    }
+    {
+        loop0(.Lparse_fill, r4)
+    }
+.Lparse_fill:
+    {
+        r1 = mpyi(r1, r8)
+    }
+    {
+        r1 = add(r1, #12345)
+    }
+    {
+        r2 = extractu(r1, #4, #16)
+    }
+    {
+        r2 = memub(r9+r2<<#0)
+    }
+    {
+        memb(r0++#1) = r2
+    }:endloop0
+
+    {
+        r10 = #200
+    }
+.Lparse_rep:
+    # r3: number being parsed, r4: digits, r5: characters left,
+    # r6: others, r7: sum of the numbers, r11: letters, r12: spaces
+    {
+        r0 = ##parse_text
+        r3 = #0
+        r4 = #0
+    }
+    {
+        r5 = #4096
+        r6 = #0
+        r7 = #0
+    }
+    {
+        r11 = #0
+        r12 = #0
+    }
+.Lparse_char:
+    {
+        r1 = memub(r0++#1)
+    }
+    {
+        r2 = add(r1, #-48)
+    }
+    {
+        p0 = cmp.gtu(r2, #9)
+        if (!p0.new) jump:nt .Lparse_digit
+    }
+    {
+        r7 = add(r7, r3)
+        r3 = #0
+    }
+    {
+        p0 = cmp.eq(r1, #32)
+        if (p0.new) jump:nt .Lparse_space
+    }
+    {
+        r2 = and(r1, #223)
+    }
+    {
+        r2 = add(r2, #-65)
+    }
+    {
+        p0 = cmp.gtu(r2, #25)
+        if (!p0.new) jump:t .Lparse_alpha
+    }
+    {
+        r6 = add(r6, #1)
+        jump .Lparse_next
+    }
+.Lparse_digit:
+    {
+        r3 = addasl(r3, r3, #2)
+        r4 = add(r4, #1)
+    }
+    {
+        r3 = addasl(r2, r3, #1)
+        jump .Lparse_next
+    }
+.Lparse_space:
+    {
+        r12 = add(r12, #1)
+        jump .Lparse_next
+    }
+.Lparse_alpha:
+    {
+        r11 = add(r11, #1)
+    }
+.Lparse_next:
+    {
+        r5 = add(r5, #-1)
+        p0 = cmp.gt(r5, #1)
+        if (p0.new) jump:t .Lparse_char
+    }
+    {
+        r10 = add(r10, #-1)
+        p0 = cmp.gt(r10, #1)
+        if (p0.new) jump:t .Lparse_rep
+    }
+    {
+        jumpr r31
+    }
+
+    .data
+    .globl bench_name
+bench_name:
+    .string "parser"
+parse_alphabet:
+    .ascii "0123456789 aZq,x"
+parse_text:
+    .space 4096
@@ -0,0 +1,138 @@
+# Purpose: benchmark kernel, four threads each running 1024 blocks of code
+# of their own, one packet per block, so that the cold run measures how
+# translation scales with the threads.  Uses the Linux syscall ABI: clone()
+# the threads, which set their flag in thread_done and exit.
+
+    .set CLONE_FLAGS, 0x50f00   # VM, FS, FILES, SIGHAND, THREAD, SYSVSEM
+    .set NR_exit, 93
+    .set NR_sched_yield, 124
+    .set NR_clone, 220
+
+    .macro cold_code
+    .rept 1024
+    {
+        r1 = add(r1, #1)
+        jump 1f
+    }
+1:
+    .endr
+    .endm
+
+# r28 is caller-saved, and copied to the child by clone()
+    .macro spawn entry, stack
+    {
+        r28 = ##\entry
+        r0 = ##CLONE_FLAGS
+        r1 = ##\stack
+    }
+    {
+        r2 = #0
+        r3 = #0
+        r4 = #0
+        r6 = #NR_clone
+    }
+    {
+        trap0(#1)
+    }
+    {
+        p0 = cmp.eq(r0, #0)
+        if (p0.new) jumpr:nt r28
+    }
+    {
+        p0 = cmp.gt(r0, #0)
+        if (!p0.new) jump:nt fail
+    }
+    .endm
+
+    .macro thread n
+thread_\n:
+    {
+        r1 = #0
+    }
+    cold_code
+    {
+        r2 = ##(thread_done + 4 * \n)
+        r3 = #1
+    }
+    {
+        memw(r2 + #0) = r3
+    }
+    {
+        r0 = #0
+        r6 = #NR_exit
+    }
+    {
+        trap0(#1)
+    }
+    .endm
+
+    .text
+    .globl bench_kernel
+bench_kernel:
+    {
+        r2 = ##thread_done
+        r5:4 = combine(#0, #0)
+    }
+    {
+        memd(r2 + #0) = r5:4
+    }
+    {
+        memd(r2 + #8) = r5:4
+    }
+    spawn thread_0, stack_0
+    spawn thread_1, stack_1
+    spawn thread_2, stack_2
+    spawn thread_3, stack_3
+.Lthreads_wait:
+    {
+        r6 = #NR_sched_yield
+    }
+    {
+        trap0(#1)
+    }
+    {
+        r2 = ##thread_done
+    }
+    {
+        r3 = memw(r2 + #0)
+        r4 = memw(r2 + #4)
+    }
+    {
+        r5 = memw(r2 + #8)
+        r7 = memw(r2 + #12)
+    }
+    {
+        r3 = and(r3, r4)
+        r5 = and(r5, r7)
+    }
+    {
+        r3 = and(r3, r5)
+    }
+    {
+        p0 = cmp.eq(r3, #0)
+        if (p0.new) jump:t .Lthreads_wait
+    }
+    {
+        jumpr r31
+    }
+
+    thread 0
+    thread 1
+    thread 2
+    thread 3
+
+    .data
+    .globl bench_name
+bench_name:
+    .string "threads"
+    .p2align 3
+thread_done:
+    .space 16
+    .space 4096
+stack_0:
+    .space 4096
+stack_1:
+    .space 4096
+stack_2:
+    .space 4096
+stack_3:
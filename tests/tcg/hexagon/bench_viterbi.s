@@ -0,0 +1,109 @@
+# Purpose: benchmark kernel, add-compare-select butterflies of a 64-state
+# Viterbi decoder over 256 symbols, repeated 100 times
+
+    .text
+    .globl bench_kernel
+bench_kernel:
+    # Pseudo-random branch metrics for the 32 butterflies
+    {
+        r0 = ##vit_bm
+        r1 = #7
+    }
+    {
+        loop0(.Lvit_fill, #32)
+    }
+.Lvit_fill:
+    {
+        r2 = and(r1, #63)
+        r1 = add(r1, #23)
+    }
+    {
+        memw(r0++#4) = r2
+    }:endloop0
+
+    {
+        r10 = #100
+    }
+.Lvit_rep:
+    # r14: old path metrics, r15: new path metrics, r9: symbol offset,
+    # r13: decision words, one per symbol
+    {
+        r14 = ##vit_metric0
+        r15 = ##vit_metric1
+        r9 = #0
+    }
+    {
+        r13 = ##vit_decision
+        r4 = #256
+    }
+    {
+        loop1(.Lvit_step, r4)
+    }
+.Lvit_step:
+    {
+        r6 = r14
+        r7 = r15
+        r12 = #0
+    }
+    {
+        r8 = ##vit_bm
+        loop0(.Lvit_bfly, #32)
+    }
+.Lvit_bfly:
+    {
+        r0 = memw(r6+#0)
+        r1 = memw(r6+#128)
+        r6 = add(r6, #4)
+    }
+    {
+        r2 = memw(r8++#4)
+    }
+    {
+        r2 = add(r2, r9)
+    }
+    {
+        r3 = add(r0, r2)
+        r4 = sub(r1, r2)
+        r5 = sub(r0, r2)
+        r11 = add(r1, r2)
+    }
+    {
+        p0 = cmp.gt(r4, r3)
+        r4 = max(r3, r4)
+        r5 = max(r5, r11)
+    }
+    {
+        memd(r7++#8) = r5:4
+        r28 = mux(p0, #1, #0)
+    }
+    {
+        r12 = addasl(r28, r12, #1)
+    }:endloop0
+    {
+        memw(r13++#4) = r12
+        r14 = r15
+        r15 = r14
+        r9 = add(r9, #3)
+    }:endloop1
+    {
+        r10 = add(r10, #-1)
+        p0 = cmp.gt(r10, #1)
+        if (p0.new) jump:t .Lvit_rep
+    }
+    {
+        jumpr r31
+    }
+
+    .data
+    .globl bench_name
+bench_name:
+    .string "viterbi"
+    .p2align 3
+vit_bm:
+    .space 128
+vit_metric0:
+    .space 256
+vit_metric1:
+    .space 256
+vit_decision:
+    .space 1024
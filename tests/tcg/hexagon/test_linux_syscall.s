@@ -0,0 +1,42 @@
+# Purpose: Linux syscall ABI test, trap0(#1) with the number in r6 and the
+# arguments in r0-r5.  write(1, msg, len) returns len, and an unknown
+# syscall number returns -ENOSYS.
+
+    .text
+    .globl _start
+    .set len, 19
+
+_start:
+    {
+        call init
+    }
+# write(1, msg, len)
+    {
+        r0=#1
+        r1=##.L.str
+        r2=#len
+        r6=#64
+    }
+    {
+        trap0(#1)
+    }
+    {
+        p0 = cmp.eq(r0, #len); if (!p0.new) jump:nt fail
+    }
+# unknown syscall
+    {
+        r6=#1000
+    }
+    {
+        trap0(#1)
+    }
+    {
+        p0 = cmp.eq(r0, #-38); if (p0.new) jump:t pass
+        jump fail
+    }
+
+.data
+
+.L.str:
+	.string	"Hello Hexagon Linux"
+	.size	.L.str, len
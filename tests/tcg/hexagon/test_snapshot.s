@@ -0,0 +1,55 @@
+# Purpose: snapshot and restore semihosting calls.  SNAPSHOT returns 0,
+# then a store to memory is undone by RESTORE, which resumes after the
+# SNAPSHOT call with 1 in r0.
+
+    .text
+    .globl _start
+
+_start:
+    {
+        call init
+    }
+# SYS_SNAPSHOT
+    {
+        r0=#0x191
+    }
+    {
+        trap0(#0)
+    }
+    {
+        r1=##counter
+    }
+    {
+        r2=memw(r1)
+    }
+    {
+        p0 = cmp.eq(r0, #1); if (p0.new) jump:t restored
+    }
+# First pass: modify the memory and rewind
+    {
+        p0 = cmp.eq(r0, #0); if (!p0.new) jump:nt fail
+    }
+    {
+        memw(r1)=#1
+    }
+# SYS_RESTORE
+    {
+        r0=#0x192
+    }
+    {
+        trap0(#0)
+    }
+    {
+        jump fail
+    }
+
+restored:
+    {
+        p0 = cmp.eq(r2, #0); if (p0.new) jump:t pass
+        jump fail
+    }
+
+.data
+
+counter:
+    .word 0
@@ -0,0 +1,46 @@
+# Purpose: a forward branch that is not taken for 150 iterations, then taken
+# for 50, so that with -hexagon-superblock it is first followed on the
+# fall-through side, then mispredicted until profiled again.  The sum must
+# be 150 * 1 + 50 * 3 = 300.
+
+    .text
+    .globl _start
+
+_start:
+    {
+        call init
+    }
+    {
+        r0 = #0
+        r1 = #0
+        r2 = #200
+        r3 = #149
+    }
+loop:
+    {
+        p0 = cmp.gt(r0, r3); if (p0.new) jump:nt rare
+    }
+    {
+        r1 = add(r1, #1)
+    }
+    {
+        jump next
+    }
+rare:
+    {
+        r1 = add(r1, #3)
+    }
+next:
+    {
+        r0 = add(r0, #1)
+    }
+    {
+        p0 = cmp.eq(r0, r2); if (!p0.new) jump:t loop
+    }
+    {
+        p0 = cmp.eq(r1, #300)
+    }
+    {
+        if (p0) jump:t pass
+        jump fail
+    }
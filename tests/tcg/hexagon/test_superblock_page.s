@@ -0,0 +1,62 @@
+# Purpose: a branch taken 200 times whose target is near the end of the
+# second page of the block, followed by packets running into the third page.
+# With -hexagon-superblock the block continues at the target, but must stop
+# before its packets leave the two pages.  The sum must be 200 * 3 = 600.
+
+    .text
+    .globl _start
+
+_start:
+    {
+        call init
+    }
+    {
+        r0 = #0
+        r1 = #0
+        r2 = #200
+    }
+    {
+        jump loop
+    }
+
+    .p2align 12
+loop:
+    {
+        p0 = cmp.eq(r0, r2)
+    }
+    {
+        if (!p0) jump:t far
+    }
+    {
+        jump done
+    }
+    # far is 20 bytes before the end of the second page: loop + 8172
+    .skip 8160
+far:
+    {
+        r1 = add(r1, #1)
+    }
+    {
+        r1 = add(r1, #1)
+    }
+    {
+        r1 = add(r1, #1)
+    }
+    {
+        r0 = add(r0, #1)
+    }
+    {
+        nop
+    }
+    # Third page
+    {
+        jump loop
+    }
+done:
+    {
+        p0 = cmp.eq(r1, #600)
+    }
+    {
+        if (p0) jump:t pass
+        jump fail
+    }